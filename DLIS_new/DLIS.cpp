@@ -1,6 +1,9 @@
 #include    <stdio.h>
 #include    <tchar.h>
+#include    <io.h>
+#include    <fcntl.h>
 #include    "DLISParser.h"
+#include    "DlisBatch.h"
 
 void  NotifyFrame(CDLISFrame *frame, void *params)
 {
@@ -46,11 +49,62 @@ void  NotifyFrame(CDLISFrame *frame, void *params)
     count++;
 }
 
+/*
+*  пакетный режим: кадры каждого файла приходят по порядку, считаем строки по файлам
+*/
+void  NotifyBatchFrame(int file, CDLISFrame *frame, void *params)
+{
+    std::vector<long> *rows = (std::vector<long> *)params;
+
+    (*rows)[file] += frame->CountRows();
+}
+
+
+int  ParseDirectory(const char *dir, int threads, int budget)
+{
+    wchar_t             buff[260] = { 0 };
+    CDLISBatch          batch;
+    std::vector<long>   rows;
+    bool                r;
+
+    MultiByteToWideChar(CP_ACP, 0, dir, (int)strlen(dir), buff, _countof(buff));
+
+    if (batch.AddDirectory(buff) == 0)
+    {
+        printf("no DLIS files in %s\n", dir);
+        return -1;
+    }
+
+    batch.SetMemoryBudget((size_t)budget * 1024 * 1024);
+    rows.resize(batch.CountFiles(), 0);
+
+    r = batch.Run(threads, &NotifyBatchFrame, &rows);
+
+    for (int i = 0; i < batch.CountFiles(); i++)
+        wprintf(L"%s\t%s\tframes: %ld\n", batch.GetFileName(i), batch.GetResult(i) ? L"ok" : L"error", rows[i]);
+
+    return r ? 0 : -1;
+}
+
 
 void Usage()
 {
     printf("Usage: \n"
            "-p \"c:\\example.dlis\"\n"
+           "-p -  read DLIS from stdin (pipe)\n"
+           "-m    read file through memory mapping\n"
+           "-r N  read ahead N chunks in background thread\n"
+           "-c drop|direct  bulk mode: drop read pages from cache / bypass cache\n"
+           "-i    open through sidecar index (<file>.idx), build it on first open\n"
+           "-s    scan visible record headers only and print record map summary\n"
+           "-b N  deliver frames to the callback in batches of N frames\n"
+           "-t N  pipeline: read, parse and decode frames in separate threads, N batches in flight\n"
+           "-j N  pipeline: decode frames on N threads (callback order is kept)\n"
+           "-f N  parse logical files of the storage unit on N threads\n"
+           "-d \"c:\\dir\"  parse all *.dlis files of the directory in a work-stealing pool\n"
+           "-w N  directory mode: N worker threads (default - number of cores)\n"
+           "-l N  directory mode: memory budget for frames in flight and read buffers, Mb\n"
+           "      (0 or not set - 512 Mb)\n"
           );
 }
 
@@ -66,6 +120,18 @@ int main(int argc, char **argv)
 
     int   i = 1;
     char  dlis_path[MAX_PATH] = {0};
+    char  dlis_dir[MAX_PATH] = {0};
+    int   workers = 0;
+    int   budget = 0;
+    bool  map_mode = false;
+    bool  scan_only = false;
+    bool  use_index = false;
+    int   read_ahead = 0;
+    int   batch = 0;
+    int   pipeline = 0;
+    int   decoders = 1;
+    int   file_threads = 1;
+    CDLISFileSource::CacheMode cache_mode = CDLISFileSource::CACHE_NORMAL;
 
     while (i < argc)
     {
@@ -80,8 +146,130 @@ int main(int argc, char **argv)
             i++;
             strcpy_s(dlis_path, argv[i]);
         }
+        else if (strcmp(argv[i], "-d") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            strcpy_s(dlis_dir, argv[i]);
+        }
+        else if (strcmp(argv[i], "-w") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            workers = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-l") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            budget = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            map_mode = true;
+        }
+        else if (strcmp(argv[i], "-i") == 0)
+        {
+            use_index = true;
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            scan_only = true;
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            read_ahead = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            batch = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            pipeline = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-j") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            decoders = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-f") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            file_threads = atoi(argv[i]);
+        }
+        else if (strcmp(argv[i], "-c") == 0)
+        {
+            if ((i + 1) >= argc)
+            {
+                Usage();
+                return -1;
+            }
+
+            i++;
+            if (strcmp(argv[i], "drop") == 0)
+                cache_mode = CDLISFileSource::CACHE_DROP_BEHIND;
+            else if (strcmp(argv[i], "direct") == 0)
+                cache_mode = CDLISFileSource::CACHE_DIRECT;
+            else
+            {
+                Usage();
+                return -1;
+            }
+        }
         i++;        
     }
+
+    if (dlis_dir[0])
+        return ParseDirectory(dlis_dir, workers, budget);
     
     if (dlis_path[0] == 0)
     {
@@ -95,10 +283,44 @@ int main(int argc, char **argv)
 
     parser.Initialize();
 	parser.CallbackNotifyFrame(&NotifyFrame, 0);
+    parser.SetMapMode(map_mode);
+    parser.SetReadAhead(read_ahead, 0);
+    parser.SetCacheMode(cache_mode);
+    parser.SetBatch(batch, 0);
+    parser.SetPipeline(pipeline, decoders);
+    parser.SetFileThreads(file_threads);
+
+    if (strcmp(dlis_path, "-") == 0)
+    {
+        CDLISStreamSource  stream;
+
+        _setmode(_fileno(stdin), _O_BINARY);
+        stream.Attach(stdin);
+        r = parser.Parse(&stream);
+    }
+    else
+    {
+        wchar_t buff[260] = { 0 };
+        MultiByteToWideChar(CP_ACP, 0, dlis_path, (int)strlen(dlis_path), buff, _countof(buff)); 
+
+        if (scan_only)
+        {
+            CDLISRecordMap *map = parser.GetRecordMap();
+            size_t          explicit_count = 0;
 
-    wchar_t buff[260] = { 0 };
-    MultiByteToWideChar(CP_ACP, 0, dlis_path, (int)strlen(dlis_path), buff, _countof(buff)); 
-    r = parser.Parse(buff);
+            r = parser.ScanRecords(buff);
+            for (size_t k = 0; k < map->Count(); k++)
+                if (CDLISRecordMap::IsExplicit(map->Get(k)))
+                    explicit_count++;
+
+            printf("visible records: %u, EFLR: %u, IFLR: %u\n", (unsigned)map->Count(), 
+                   (unsigned)explicit_count, (unsigned)(map->Count() - explicit_count));
+        }
+        else if (use_index)
+            r = parser.Open(buff);
+        else
+            r = parser.Parse(buff);
+    }
     //printf("all frames: %d, bad frames: %d\n", parser.CountAllFrames(), parser.CountBadFrames());
 
     parser.Shutdown();
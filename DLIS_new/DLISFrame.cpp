@@ -1,13 +1,19 @@
 #include "StdAfx.h"
 #include "DLISFrame.h"
+#include "DlisSwap.h"
+#include "DlisConvert.h"
 #include "windows.h"
 #include "assert.h"
 
 
-CDLISFrame::CDLISFrame() : m_channels(NULL), m_channels_count(0), m_frame_len(0), m_count(0)
+CDLISFrame::CDLISFrame() : m_channels(NULL), m_frame_len(0), m_channels_count(0), m_count(0), m_decoded(false), m_block_unit(0),
+    m_block_code(RC_UNDEFINED), m_converted_len(0), m_variable(false)
 {
     memset(&m_buffer, 0, sizeof(m_buffer));
     memset(&m_numbers, 0, sizeof(m_numbers));
+    memset(&m_converted, 0, sizeof(m_converted));
+    memset(&m_flags, 0, sizeof(m_flags));
+    memset(&m_offsets, 0, sizeof(m_offsets));
 }
 
 
@@ -18,8 +24,16 @@ CDLISFrame::~CDLISFrame()
 
 bool CDLISFrame::Initialize()
 {
-    m_buffer.size  = 0;
-    m_numbers.size = 0;
+    //       -  
+    if (m_decoded && m_flags.data)
+        memset(m_flags.data, 0, m_flags.max_size);
+
+    m_buffer.size    = 0;
+    m_numbers.size   = 0;
+    m_converted.size = 0;
+    m_offsets.size   = 0;
+    m_count          = 0;
+    m_decoded        = false;
 
     return true;
 }
@@ -33,39 +47,157 @@ void CDLISFrame::Shutdown()
     if (m_numbers.data)
         delete[] m_numbers.data;
 
+    m_converted.Free();
+    m_flags.Free();
+    m_offsets.Free();
+
     memset(&m_buffer, 0, sizeof(m_buffer));
     memset(&m_numbers, 0, sizeof(m_numbers));
 }
 
 
+/*
+*   :     ,   
+*  (   ,   )
+*/
+void CDLISFrame::Swap(CDLISFrame *frame)
+{
+    CDLISFrame tmp;
+
+    tmp    = *frame;
+    *frame = *this;
+    *this  = tmp;
+}
+
+
 bool CDLISFrame::AddRawData(int number, char *raw_data, int raw_data_size)
 {
-    //  
-    if (!m_buffer.Resize(m_buffer.size + raw_data_size))
-        return false;
-    
-    memcpy(m_buffer.data + m_buffer.size, raw_data, raw_data_size);
-    m_buffer.size += raw_data_size;
+    char *row;
+
+    assert(raw_data_size == m_frame_len);
 
-    m_count = (int)m_buffer.size / m_frame_len;
-    //
-    if (!m_numbers.Resize(sizeof(int)))
+    row = AddRow(number);
+    if (!row)
         return false;
 
+    memcpy(row, raw_data, raw_data_size);
+    return true;
+}
+
+
+char *CDLISFrame::AddRow(int number)
+{
+    char *row;
+
+    //      
+    assert(!m_decoded && !m_variable);
+
+    if (!m_buffer.Resize(m_buffer.size + m_frame_len))
+        return NULL;
+
+    if (!m_numbers.Resize(m_numbers.size + sizeof(int)))
+        return NULL;
+
+    row = m_buffer.data + m_buffer.size;
+    m_buffer.size += m_frame_len;
+
     memcpy(m_numbers.data + m_numbers.size, &number, sizeof(int));
     m_numbers.size += sizeof(int);
 
-    return true;
+    m_count++;
+    return row;
 }
 
+/*
+*     len, offsets -      
+*/
+char *CDLISFrame::AddRowVariable(int number, int len, const int *offsets)
+{
+    char *row;
+    int  *dst;
+
+    assert(!m_decoded && m_variable);
 
-void CDLISFrame::AddChannels(DlisValueObjName *object, DlisChannelInfo *channels, int channels_count, int frame_len)
+    if (!m_buffer.Resize(m_buffer.size + len))
+        return NULL;
+
+    if (!m_numbers.Resize(m_numbers.size + sizeof(int)))
+        return NULL;
+
+    if (!m_offsets.Resize(m_offsets.size + m_channels_count * sizeof(int)))
+        return NULL;
+
+    row = m_buffer.data + m_buffer.size;
+    dst = (int *)(m_offsets.data + m_offsets.size);
+    for (int i = 0; i < m_channels_count; i++)
+        dst[i] = (int)m_buffer.size + offsets[i];
+
+    m_buffer.size  += len;
+    m_offsets.size += m_channels_count * sizeof(int);
+
+    memcpy(m_numbers.data + m_numbers.size, &number, sizeof(int));
+    m_numbers.size += sizeof(int);
+
+    m_count++;
+    return row;
+}
+
+/*
+*     
+*/
+void CDLISFrame::RemoveRow()
+{
+    if (m_count == 0)
+        return;
+
+    if (m_variable)
+    {
+        m_offsets.size -= m_channels_count * sizeof(int);
+        m_buffer.size   = ((int *)m_offsets.data)[m_offsets.size / sizeof(int)];
+    }
+    else
+        m_buffer.size  -= m_frame_len;
+
+    m_numbers.size -= sizeof(int);
+    m_count--;
+}
+
+
+void CDLISFrame::AddChannels(DlisValueObjName *object, DlisChannelInfo *channels, int channels_count, int frame_len, bool variable)
 {
     m_obj_key        = *object;
     m_channels       = channels;
     m_channels_count = channels_count;
 
     m_frame_len      = frame_len;
+
+    //       (UVARI, IDENT, OBNAME, ...) -   
+    //   ,         
+    m_variable = variable;
+    for (int i = 0; i < channels_count; i++)
+        if (channels[i].element_size <= 0)
+            m_variable = true;
+
+    //       -      
+    m_block_unit = channels_count > 0 ? SwapUnit(channels[0].code) : 0;
+    for (int i = 0; i < channels_count && m_block_unit > 1; i++)
+        if (SwapUnit(channels[i].code) != m_block_unit)
+            m_block_unit = 0;
+
+    m_block_code    = channels_count > 0 ? channels[0].code : RC_UNDEFINED;
+    m_converted_len = 0;
+    for (int i = 0; i < channels_count; i++)
+    {
+        if (channels[i].code != m_block_code)
+            m_block_code = RC_UNDEFINED;
+
+        if (channels[i].code == RC_FSHORT)
+            m_converted_len += channels[i].dimension;
+    }
+
+    //    (       )
+    if (m_flags.Resize(channels_count))
+        memset(m_flags.data, 0, m_flags.max_size);
 }
 
 int CDLISFrame::GetNumber(int row)
@@ -86,6 +218,12 @@ char *CDLISFrame::GetColumnName(int column)
 }
 
 
+const DlisChannelInfo *CDLISFrame::GetChannel(int column)
+{
+    return &m_channels[column];
+}
+
+
 DlisValueObjName *CDLISFrame::GetObject()
 {
     return &m_obj_key;
@@ -132,71 +270,265 @@ int CDLISFrame::CountRows()
 }
 
 
-void CDLISFrame::Big2LittelEndian(void *data, int len)
+size_t CDLISFrame::CountBytes()
 {
-    char *dst;
-    char  tmp;
+    return m_buffer.size;
+}
+
 
-    dst = (char *)data;
+/*
+*    :            -
+*       ,    
+*/
+void CDLISFrame::Decode()
+{
+    if (m_count == 0)
+        return;
 
-    switch (len)
+    if (!m_decoded && m_block_unit > 1 && (size_t)m_channels_count <= m_flags.max_size)
     {
-        case 2:
-            tmp    = dst[0];
-            dst[0] = dst[1];
-            dst[1] = tmp;
-            break;
+        m_decoded = true;
+
+        CDLISSwap::Swap(m_buffer.data, m_block_unit, m_buffer.size / m_block_unit);
+
+        if (m_block_code == RC_ISINGL)
+            CDLISConvert::IbmToFloat(m_buffer.data, sizeof(float), m_buffer.size / sizeof(float));
+        else if (m_block_code == RC_VSINGL)
+            CDLISConvert::VaxToFloat(m_buffer.data, sizeof(float), m_buffer.size / sizeof(float));
+
+        // FSHORT     , IBM  VAX 
+        //       -  
+        for (int i = 0; i < m_channels_count; i++)
+        {
+            if (m_channels[i].code == RC_FSHORT)
+                ConvertFshort(i);
+            else if (m_block_code == RC_UNDEFINED && (m_channels[i].code == RC_ISINGL || m_channels[i].code == RC_VSINGL))
+                ConvertFloat(i);
+
+            m_flags.data[i] = 1;
+        }
+        return;
+    }
 
-        case 4:
-            tmp    = dst[0];
-            dst[0] = dst[3];
-            dst[3] = tmp;
+    for (int i = 0; i < m_channels_count; i++)
+        DecodeChannel(i);
+}
 
-            tmp    = dst[1];
-            dst[1] = dst[2];
-            dst[2] = tmp;
-            break;
+/*
+*          ,  -  
+*/
+void CDLISFrame::DecodeChannel(int column)
+{
+    DlisChannelInfo  *channel;
+    int               unit;
 
-        case 8:
-            tmp    = dst[0];
-            dst[0] = dst[7];
-            dst[7] = tmp;
+    if (m_count == 0)
+        return;
 
-            tmp    = dst[1];
-            dst[1] = dst[6];
-            dst[6] = tmp;
+    //      -    
+    if ((size_t)m_channels_count > m_flags.max_size)
+    {
+        if (!m_decoded)
+        {
+            m_decoded = true;
+            for (int i = 0; i < m_channels_count; i++)
+                SwapChannel(i);
+        }
+        return;
+    }
 
-            tmp    = dst[2];
-            dst[2] = dst[5];
-            dst[5] = tmp;
+    if (m_flags.data[column])
+        return;
 
-            tmp    = dst[3];
-            dst[3] = dst[4];
-            dst[4] = tmp;
-            break;
+    m_decoded             = true;
+    m_flags.data[column]  = 1;
+
+    channel = &m_channels[column];
+    unit    = SwapUnit(channel->code);
+    if (unit < 2)
+        return;
+
+    SwapChannel(column);
 
+    if (channel->code == RC_FSHORT)
+    {
+        ConvertFshort(column);
+        return;
     }
+
+    if (channel->code == RC_ISINGL || channel->code == RC_VSINGL)
+        ConvertFloat(column);
 }
 
-void *CDLISFrame::GetValue(int column, int row, int *dimension)
+/*
+*  IBM  VAX float    IEEE   (  )
+*/
+void CDLISFrame::ConvertFloat(int column)
 {
-    void     *ret;
-    char     *data, *ptr;
-    DlisChannelInfo  *channel;
+    DlisChannelInfo  *channel = &m_channels[column];
+    int               values;
+    char             *data;
 
-    channel = &m_channels[column];
+    values = channel->dimension * channel->element_size / sizeof(float);
+    data   = m_buffer.data + channel->offsets;
 
-    data = m_buffer.data + m_frame_len * row + channel->offsets;
-    ptr  = data;
-    for (int i = 0; i < channel->dimension; i++)
+    //    (   ) -    ,
+    //       (. CDLISSwap::SwapStrided)
+    if (values >= m_count || m_variable)
     {
-        Big2LittelEndian(ptr, channel->element_size);
-        ptr += channel->element_size;
+        for (int row = 0; row < m_count; row++)
+        {
+            data = CellGet(row, column);
+            if (channel->code == RC_ISINGL)
+                CDLISConvert::IbmToFloat(data, sizeof(float), values);
+            else
+                CDLISConvert::VaxToFloat(data, sizeof(float), values);
+        }
     }
+    else
+    {
+        for (int k = 0; k < values; k++, data += sizeof(float))
+        {
+            if (channel->code == RC_ISINGL)
+                CDLISConvert::IbmToFloat(data, m_frame_len, m_count);
+            else
+                CDLISConvert::VaxToFloat(data, m_frame_len, m_count);
+        }
+    }
+}
 
-    *dimension = channel->dimension;
+/*
+*       big endian
+*/
+void CDLISFrame::SwapChannel(int column)
+{
+    DlisChannelInfo  *channel = &m_channels[column];
+    int               unit, values;
+    char             *data;
 
-    ret = (void *)data;
-    return ret;
+    unit = SwapUnit(channel->code);
+    if (unit < 2)
+        return;
 
+    values = channel->dimension * channel->element_size / unit;
+    data   = m_buffer.data + channel->offsets;
+
+    //    (   ) -    ,
+    //       (. CDLISSwap::SwapStrided)
+    if (values >= m_count || m_variable)
+    {
+        for (int row = 0; row < m_count; row++)
+            CDLISSwap::Swap(CellGet(row, column), unit, values);
+    }
+    else
+    {
+        for (int k = 0; k < values; k++, data += unit)
+            CDLISSwap::SwapStrided(data, unit, m_frame_len, m_count);
+    }
 }
+
+/*
+*  FSHORT   float   :   -   FSHORT  ,
+*    
+*/
+void CDLISFrame::ConvertFshort(int column)
+{
+    DlisChannelInfo  *channel = &m_channels[column];
+    float            *dst;
+
+    if (m_converted.size == 0)
+    {
+        if (!m_converted.Resize((size_t)m_count * m_converted_len * sizeof(float)))
+            return;
+
+        m_converted.size = (size_t)m_count * m_converted_len * sizeof(float);
+    }
+
+    dst = (float *)m_converted.data + ConvertedPos(column);
+
+    for (int row = 0; row < m_count; row++, dst += m_converted_len)
+        CDLISConvert::FshortToFloat(CellGet(row, column), sizeof(short), dst, channel->dimension);
+}
+
+/*
+*      :         
+*/
+char *CDLISFrame::CellGet(int row, int column)
+{
+    if (m_variable)
+        return m_buffer.data + ((int *)m_offsets.data)[(size_t)row * m_channels_count + column];
+
+    return m_buffer.data + (size_t)m_frame_len * row + m_channels[column].offsets;
+}
+
+/*
+*     FSHORT     
+*/
+size_t CDLISFrame::ConvertedPos(int column)
+{
+    size_t pos = 0;
+
+    for (int i = 0; i < column; i++)
+        if (m_channels[i].code == RC_FSHORT)
+            pos += m_channels[i].dimension;
+
+    return pos;
+}
+
+/*
+*   ,    (0, 1 -   ):
+*     (validated, complex)    
+*/
+int CDLISFrame::SwapUnit(RepresentationCodes code)
+{
+    switch (code)
+    {
+        case RC_FSHORT:
+        case RC_SNORM:
+        case RC_UNORM:
+            return 2;
+
+        case RC_FSINGL:
+        case RC_FSING1:
+        case RC_FSING2:
+        case RC_ISINGL:
+        case RC_VSINGL:
+        case RC_CSINGL:
+        case RC_SLONG:
+        case RC_ULONG:
+            return 4;
+
+        case RC_FDOUBL:
+        case RC_FDOUB1:
+        case RC_FDOUB2:
+        case RC_CDOUBL:
+            return 8;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+void *CDLISFrame::GetValue(int column, int row, int *dimension)
+{
+    DlisChannelInfo  *channel;
+
+    //        
+    DecodeChannel(column);
+
+    channel    = &m_channels[column];
+    *dimension = channel->dimension;
+
+    // FSHORT     
+    if (channel->code == RC_FSHORT)
+    {
+        if (!m_converted.size)
+            return NULL;
+
+        return (void *)((float *)m_converted.data + (size_t)row * m_converted_len + ConvertedPos(column));
+    }
+
+    return (void *)CellGet(row, column);
+}
\ No newline at end of file
@@ -11,33 +11,70 @@ private:
     int               m_frame_len;
     int               m_channels_count;
     int               m_count;
+    // хотя бы один столбец уже преобразован из big endian (строки больше не добавляются)
+    bool              m_decoded;
+    // все каналы кадра из значений одной длины - блок преобразуется одним вызовом
+    int               m_block_unit;
+    // код всех каналов кадра, если он одинаковый (иначе RC_UNDEFINED)
+    RepresentationCodes m_block_code;
+    // количество значений FSHORT в строке, они преобразуются во float в отдельный буфер
+    int               m_converted_len;
+    // в кадре есть каналы переменной длины: строки разной длины, смещения значений хранятся для каждой строки
+    bool              m_variable;
 
     DlisValueObjName  m_obj_key;
     MemoryBuffer      m_buffer;
     MemoryBuffer      m_numbers;
+    MemoryBuffer      m_converted;
+    // по байту на канал: столбец канала уже преобразован
+    MemoryBuffer      m_flags;
+    // смещения значений каналов в m_buffer для строк переменной длины (по int на канал)
+    MemoryBuffer      m_offsets;
 
 public:
     CDLISFrame();
     ~CDLISFrame();
     bool            Initialize();
     void            Shutdown();
+    // обмен содержимым (буферы не копируются)
+    void            Swap(CDLISFrame *frame);
 
     bool            AddRawData(int number, char *raw_data, int raw_data_size);
-    void            AddChannels(DlisValueObjName *object, DlisChannelInfo *channels, int channels_count, int frame_len);
+    // место под строку кадра number, данные пишутся прямо в хранилище (указатель действителен до следующего AddRow)
+    char           *AddRow(int number);
+    // строка кадра с каналами переменной длины: len байт, offsets - начала значений каналов в строке
+    char           *AddRowVariable(int number, int len, const int *offsets);
+    void            RemoveRow();
+    // variable - строки кадра переменной длины (добавляются через AddRowVariable)
+    void            AddChannels(DlisValueObjName *object, DlisChannelInfo *channels, int channels_count, int frame_len, bool variable);
     //
     int               GetNumber(int column);
     char             *GetColumnName(int column);
+    const DlisChannelInfo *GetChannel(int column);
     DlisValueObjName *GetObject();
 
+    // ISINGL, VSINGL и FSHORT отдаются уже преобразованными в IEEE float,
+    // значения каналов переменной длины (UVARI, IDENT, ASCII, OBNAME, ...) - в кодировке файла
     float          *GetValueFloat(int column, int row, int *dimension);
     double         *GetValueDouble(int column, int row, int *dimension);
     int            *GetValueInt(int column, int row, int *dimension);
 
     int             CountColumns();
     int             CountRows();
+    // объем данных строк в байтах
+    size_t          CountBytes();
 
-private:
-    inline void     Big2LittelEndian(void *dst, int len);
+    // преобразование всех столбцов из big endian (уже преобразованные не трогаются)
+    void            Decode();
+    // преобразование столбца одного канала, выполняется при первом обращении к его значениям
+    void            DecodeChannel(int column);
 
+private:
     void           *GetValue(int column, int row, int *dimension);
+    char           *CellGet(int row, int column);
+    void            SwapChannel(int column);
+    void            ConvertFshort(int column);
+    void            ConvertFloat(int column);
+    size_t          ConvertedPos(int column);
+    static int      SwapUnit(RepresentationCodes code);
 };
\ No newline at end of file
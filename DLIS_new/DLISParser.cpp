@@ -1,5 +1,6 @@
 #include "StdAfx.h"
 #include "DLISParser.h"
+#include "DlisConvert.h"
 #include "stdio.h"
 #include "stdlib.h"
 #include "stddef.h"
@@ -38,11 +39,12 @@ CDLISParser::RepresentaionCodesLenght CDLISParser::s_rep_codes_length[RC_LAST] =
 };
 
 
-CDLISParser::CDLISParser() : m_file(INVALID_HANDLE_VALUE), m_state(STATE_PARSER_FIRST), 
+CDLISParser::CDLISParser() : m_source(NULL), m_map_mode(false), m_chunk_size(FILE_CHUNK), m_read_ahead_depth(0), m_state(STATE_PARSER_FIRST), 
     m_sets(NULL), m_set_tail(NULL), m_object_tail(NULL), m_attribute_tail(NULL), m_column_tail(NULL),m_frame_tail(NULL),
     m_last_set(NULL), m_last_root_set(NULL), m_last_object(NULL), m_last_column(NULL), m_last_attribute(NULL),
     m_pull_id_strings(0), m_pull_id_objects(0), m_pull_id_frame_data(0), 
-    m_last_frame(NULL), m_frame_data(NULL), m_notify_frame_func(NULL), m_notify_params(NULL)
+    m_last_frame(NULL), m_frame_data(NULL), m_index_build(false),
+    m_batch_frames(0), m_batch_bytes(0), m_batch_data(NULL), m_cursor(false), m_cursor_ready(false), m_cursor_batch(0), m_pipeline_depth(0), m_pipeline_threads(1), m_file_threads(1), m_part_owner(NULL), m_part_index(0), m_part_done(false), m_notify_frame_func(NULL), m_notify_params(NULL)
 {
     memset(&m_segment,             0, sizeof(m_segment));
     memset(&m_storage_unit_label,  0, sizeof(m_storage_unit_label));
@@ -50,6 +52,8 @@ CDLISParser::CDLISParser() : m_file(INVALID_HANDLE_VALUE), m_state(STATE_PARSER_
     memset(&m_visible_record,      0, sizeof(m_visible_record));
     memset(&m_segment_header,      0, sizeof(m_segment_header));
     memset(&m_component_header,    0, sizeof(m_component_header));
+    memset(&m_frame_request,       0, sizeof(m_frame_request));
+    memset(&m_value,               0, sizeof(m_value));
 }
 
 
@@ -64,10 +68,604 @@ bool CDLISParser::Parse(const wchar_t *file_name)
     if (!file_name)
         return false;
 
+    if (m_file_threads > 1)
+        return ParseParallel(file_name);
+
     // открываем файл
     if (!FileOpen(file_name))
         return false;
 
+    return Parse(&m_file_source);
+}
+
+/*
+*  логический файл начинается с FHLR; по карте visible record находим записи, первый сегмент
+*  которых - начало FHLR, и разбираем участки между ними независимо. FHLR не в начале
+*  visible record границей не считается: такой логический файл разбирается вместе с предыдущим
+*/
+bool CDLISParser::ParseParallel(const wchar_t *file_name)
+{
+    std::vector<UINT64>  bounds;
+    std::vector<char>    results;
+    std::vector<std::thread> threads;
+    size_t               count;
+    bool                 r = true;
+
+    if (!ScanRecords(file_name) || m_record_map.Count() == 0)
+        return false;
+
+    for (size_t i = 0; i < m_record_map.Count(); i++)
+    {
+        CDLISRecordMap::Record *record = m_record_map.Get(i);
+
+        if (i == 0 || (record->type == FHLR && CDLISRecordMap::IsExplicit(record) && !CDLISRecordMap::IsContinued(record)))
+            bounds.push_back(record->offset);
+    }
+    bounds.push_back(m_record_map.Get(m_record_map.Count() - 1)->offset + m_record_map.Get(m_record_map.Count() - 1)->length);
+
+    // заголовок DLIS читаем сами, участки его не содержат
+    if (!FileOpen(file_name))
+        return false;
+
+    m_source = &m_file_source;
+    if (!BufferInitialize(false) || !ReadStorageUnitLabel())
+        return false;
+
+    count = bounds.size() - 1;
+    for (size_t i = 0; i < count; i++)
+    {
+        CDLISParser *part = new(std::nothrow) CDLISParser();
+        if (!part)
+            return false;
+
+        m_parts.push_back(part);
+        if (!part->Initialize())
+            return false;
+
+        // участок разбирается с теми же настройками чтения, пакетов и конвейера, что и весь файл
+        part->m_map_mode         = m_map_mode;
+        part->m_chunk_size       = m_chunk_size;
+        part->m_read_ahead_depth = m_read_ahead_depth;
+        part->m_pipeline_depth   = m_pipeline_depth;
+        part->m_pipeline_threads = m_pipeline_threads;
+        part->m_projection       = m_projection;
+        part->m_batch_frames     = m_batch_frames;
+        part->m_batch_bytes      = m_batch_bytes;
+        part->m_part_owner       = this;
+        part->m_part_index       = i;
+        part->SetCacheMode(m_file_source.GetCacheMode());
+
+        if (m_notify_frame_func)
+            part->CallbackNotifyFrame(NotifyPart, this);
+    }
+
+    // потоки берут следующий неразобранный участок, пока они есть
+    std::atomic<size_t> next(0);
+
+    results.resize(count, 0);
+    for (int i = 0; i < m_file_threads && (size_t)i < count; i++)
+    {
+        threads.push_back(std::thread([&]()
+        {
+            for (size_t k = next++; k < count; k = next++)
+            {
+                results[k] = m_parts[k]->ParseRange(file_name, bounds[k], bounds[k + 1]);
+                m_parts[k]->m_part_done = true;
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    // корни логических файлов в порядке файла
+    DlisSet **tail = &m_sets;
+
+    while (*tail)
+        tail = &(*tail)->next;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!results[i])
+            r = false;
+
+        *tail = m_parts[i]->m_sets;
+        while (*tail)
+            tail = &(*tail)->next;
+    }
+
+    return r;
+}
+
+/*
+*  разбор участка [begin, end) файла: конец участка для буфера чтения - конец данных
+*/
+bool CDLISParser::ParseRange(const wchar_t *file_name, UINT64 begin, UINT64 end)
+{
+    if (!FileOpen(file_name))
+        return false;
+
+    return ParseRange(&m_file_source, begin, end);
+}
+
+
+bool CDLISParser::ParseRange(CDLISSource *source, UINT64 begin, UINT64 end)
+{
+    if (!source || end < begin)
+        return false;
+
+    m_source = source;
+    ParseEnd();
+
+    if (!BufferInitialize(false) || !BufferSeek(begin))
+        return false;
+
+    if (m_file_chunk.mapped)
+        m_file_chunk.remaind = (size_t)(end - begin);
+    else
+        m_file_chunk.file_remaind = end - begin;
+
+    // упреждающее чтение - только после перехода к началу участка и до его конца
+    if (!BufferReadAhead())
+        return false;
+
+    if (m_pipeline_depth && m_notify_frame_func && !m_pipeline.Start(m_pipeline_depth, m_pipeline_threads, m_notify_frame_func, m_notify_params))
+        return false;
+
+    if (!ReadLogicalFiles())
+    {
+        m_batch_data = NULL;
+        m_pipeline.Stop();
+        return false;
+    }
+
+    FrameBatchFlush();
+    m_pipeline.Stop();
+
+    return true;
+}
+
+/*
+*  кадры из потоков логических файлов отдаются в callback по одному
+*/
+void CDLISParser::NotifyPart(CDLISFrame *frame, void *params)
+{
+    CDLISParser *parser = (CDLISParser *)params;
+
+    std::lock_guard<std::mutex> guard(parser->m_notify_lock);
+
+    parser->m_notify_frame_func(frame, parser->m_notify_params);
+}
+
+
+void CDLISParser::PartsFree()
+{
+    for (size_t i = 0; i < m_parts.size(); i++)
+    {
+        m_parts[i]->Shutdown();
+        delete m_parts[i];
+    }
+
+    m_parts.clear();
+}
+
+
+/*
+*  открытие файла по индексу: если индекс есть и соответствует файлу, читаем с диска только EFLR,
+*  иначе разбираем файл целиком (без выдачи кадров) и сохраняем индекс для следующих открытий
+*/
+bool CDLISParser::Open(const wchar_t *file_name)
+{
+    std::wstring        index_name;
+    DlisNotifyCallback  notify;
+    bool                r;
+
+    if (!FileOpen(file_name))
+        return false;
+
+    m_source = &m_file_source;
+    IndexName(file_name, &index_name);
+
+    if (m_index.Load(index_name.c_str(), m_file_source.File()))
+        return ReadIndexed();
+
+    m_index.Free();
+
+    notify = m_notify_frame_func;
+    m_notify_frame_func = NULL;
+    m_index_build       = true;
+
+    r = Parse(&m_file_source);
+
+    m_index_build       = false;
+    m_notify_frame_func = notify;
+
+    // индекс не удалось записать (например, каталог только для чтения) - не ошибка, он просто не ускорит следующее открытие
+    if (r)
+        m_index.Save(index_name.c_str(), m_file_source.File());
+
+    return r;
+}
+
+/*
+*  выборочное чтение кадров по номерам
+*/
+bool CDLISParser::ReadFrames(DlisObject *frame_obj, int first, int last, CDLISFrame *frame)
+{
+    if (first >= last)
+        return false;
+
+    memset(&m_frame_request, 0, sizeof(m_frame_request));
+    m_frame_request.first = first;
+    m_frame_request.last  = last;
+
+    return FrameRequestRead(frame_obj, frame);
+}
+
+/*
+*  выборочное чтение кадров по интервалу значений индексного (первого) канала: глубина, время
+*/
+bool CDLISParser::ReadFramesByIndex(DlisObject *frame_obj, double from, double to, CDLISFrame *frame)
+{
+    memset(&m_frame_request, 0, sizeof(m_frame_request));
+    m_frame_request.by_index   = true;
+    m_frame_request.index_from = from < to ? from : to;
+    m_frame_request.index_to   = from < to ? to : from;
+
+    return FrameRequestRead(frame_obj, frame);
+}
+
+/*
+*  по индексу находим IFLR фрейма, подходящие под запрос, и разбираем только их, переходя к ним по смещению
+*/
+bool CDLISParser::FrameRequestRead(DlisObject *frame_obj, CDLISFrame *frame)
+{
+    FrameData  *data;
+    DlisSet    *root, *last_root;
+    int         index;
+    bool        r = true;
+
+    std::vector<const CDLISIndex::Record *>  records;
+    size_t      begin, end;
+
+    if (!frame_obj || !frame || !m_source)
+        return false;
+
+    root = LogicalFileFind(frame_obj->set);
+    if (!root)
+        return false;
+
+    index = m_index.FrameFind(&frame_obj->name, LogicalFileIndex(root));
+    if (index == CDLISIndex::NO_FRAME)
+        return false;
+
+    // IFLR разбираются в контексте своего логического файла
+    last_root       = m_last_root_set;
+    m_last_root_set = root;
+
+    data = FrameDataFind(&frame_obj->name, root);
+    if (!data)
+        data = FrameDataBuild(&frame_obj->name);
+    // интервал по индексу ищем только по числовому каналу
+    if (data && m_frame_request.by_index && !ChannelValue(&data->channels[0], NULL, NULL))
+        data = NULL;
+    if (!data)
+    {
+        m_last_root_set = last_root;
+        return false;
+    }
+
+    frame->Initialize();
+    frame->AddChannels(&data->obj_key, data->selected, data->selected_count, data->selected_len, data->variable);
+
+    m_frame_request.data  = data;
+    m_frame_request.frame = frame;
+
+    // записи фрейма в порядке файла, номера кадров в них растут
+    for (size_t i = 0; i < m_index.RecordCount(); i++)
+    {
+        const CDLISIndex::Record *record = m_index.RecordGet(i);
+
+        if (record->frame != index)
+            continue;
+
+        if (!m_frame_request.by_index && ((int)record->last_frame < m_frame_request.first || (int)record->first_frame >= m_frame_request.last))
+            continue;
+
+        records.push_back(record);
+    }
+
+    begin = 0;
+    end   = records.size();
+
+    if (m_frame_request.by_index && !records.empty())
+        IndexSearch(&data->channels[0], &records[0], records.size(), &begin, &end);
+
+    for (size_t i = begin; r && i < end; i++)
+        r = ReadLogicalRecord(records[i]);
+
+    memset(&m_frame_request, 0, sizeof(m_frame_request));
+    m_last_root_set = last_root;
+
+    return r;
+}
+
+/*
+*  бинарный поиск серий записей, которые могут содержать значения индекса из интервала запроса:
+*  значение индекса первого кадра серии читаем позиционно, не разбирая запись целиком.
+*  Индекс монотонен, направление определяем по первой и последней записи
+*/
+void CDLISParser::IndexSearch(DlisChannelInfo *channel, const CDLISIndex::Record **records, size_t count, size_t *begin, size_t *end)
+{
+    double   first_value, last_value, from, to, sign;
+    size_t   lo, hi, mid;
+
+    *begin = 0;
+    *end   = count;
+
+    if (!RecordIndexValue(records[0], channel, &first_value) || !RecordIndexValue(records[count - 1], channel, &last_value))
+        return;
+
+    // для убывающего индекса ищем по значениям с обратным знаком
+    sign = first_value <= last_value ? 1.0 : -1.0;
+    from = sign > 0 ? m_frame_request.index_from : -m_frame_request.index_to;
+    to   = sign > 0 ? m_frame_request.index_to   : -m_frame_request.index_from;
+
+    // первая серия, начинающаяся после конца интервала
+    lo = 0; 
+    hi = count;
+    while (lo < hi)
+    {
+        double value;
+
+        mid = lo + (hi - lo) / 2;
+        if (!RecordIndexValue(records[mid], channel, &value))
+            return;
+
+        if (sign * value > to)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *end = lo;
+
+    // последняя серия, начинающаяся не позже начала интервала
+    lo = 0;
+    hi = *end;
+    while (lo < hi)
+    {
+        double value;
+
+        mid = lo + (hi - lo) / 2;
+        if (!RecordIndexValue(records[mid], channel, &value))
+        {
+            *begin = 0;
+            return;
+        }
+
+        if (sign * value > from)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    *begin = lo > 0 ? lo - 1 : 0;
+}
+
+/*
+*  значение индексного канала первого кадра записи: заголовок сегмента, имя фрейма, номер кадра
+*  и первый элемент читаем одним небольшим позиционным чтением.
+*  false - значение не помещается в первый сегмент или запись зашифрована
+*/
+bool CDLISParser::RecordIndexValue(const CDLISIndex::Record *record, DlisChannelInfo *channel, double *value)
+{
+    byte      data[INDEX_PROBE];
+    size_t    readed, pos, end;
+
+    if (!SourceReadAt(record->vr_offset + sizeof(VisibleRecordHeader) + record->segment_pos, (char *)data, sizeof(data), &readed))
+        return false;
+
+    if (readed < 4 || (record->attributes & Encryption))
+        return false;
+
+    // данные сегмента идут за 4 байтами заголовка
+    end = ((size_t)data[0] << 8) | data[1];
+    if (end > readed)
+        end = readed;
+    pos = 4;
+
+    // имя фрейма: ORIGIN (UVARI), копия (USHORT), IDENT; затем номер кадра (UVARI)
+    if (pos < end)
+        pos += UvariLength(data[pos]);
+    pos += 1;
+    if (pos < end)
+        pos += 1 + data[pos];
+    if (pos < end)
+        pos += UvariLength(data[pos]);
+
+    if (pos + channel->element_size > end)
+        return false;
+
+    return ChannelValue(channel, (char *)data + pos, value);
+}
+
+/*
+*  полная длина UVARI по первому байту: старшие биты задают 1, 2 или 4 байта
+*/
+size_t CDLISParser::UvariLength(byte first)
+{
+    if ((first & 0xC0) == 0xC0)
+        return 4;
+
+    if (first & 0x80)
+        return 2;
+
+    return 1;
+}
+
+/*
+*  чтение по смещению в обход буфера разбора: из отображения или позиционным чтением файла
+*/
+bool CDLISParser::SourceReadAt(UINT64 offset, char *data, size_t len, size_t *readed)
+{
+    *readed = 0;
+
+    if (m_file_chunk.mapped)
+    {
+        if (offset >= m_file_chunk.size)
+            return false;
+
+        if (len > m_file_chunk.size - (size_t)offset)
+            len = m_file_chunk.size - (size_t)offset;
+
+        memcpy(data, m_file_chunk.data + offset, len);
+        *readed = len;
+        return true;
+    }
+
+    if (m_source != &m_file_source)
+        return false;
+
+    return m_file_source.File()->ReadAt(offset, data, len, readed);
+}
+
+/*
+*  числовое значение элемента канала из сырых данных кадра (big endian),
+*  raw == NULL - только проверка, что код канала числовой
+*/
+bool CDLISParser::ChannelValue(DlisChannelInfo *channel, const char *raw, double *value)
+{
+    byte   buf[8];
+    int    len;
+
+    switch (channel->code)
+    {
+        case RC_FSINGL:
+        case RC_FSING1:
+        case RC_FSING2:
+        case RC_ISINGL:
+        case RC_VSINGL:
+        case RC_SLONG:
+        case RC_ULONG:
+            len = 4;
+            break;
+
+        case RC_FDOUBL:
+        case RC_FDOUB1:
+        case RC_FDOUB2:
+            len = 8;
+            break;
+
+        case RC_FSHORT:
+        case RC_SNORM:
+        case RC_UNORM:
+            len = 2;
+            break;
+
+        case RC_SSHORT:
+        case RC_USHORT:
+            len = 1;
+            break;
+
+        default:
+            return false;
+    }
+
+    if (!raw)
+        return true;
+
+    memcpy(buf, raw, len);
+    Big2LittelEndian(buf, len);
+
+    switch (channel->code)
+    {
+        case RC_FSINGL:
+        case RC_FSING1:
+        case RC_FSING2:  *value = *(float *)buf;           break;
+        case RC_FDOUBL:
+        case RC_FDOUB1:
+        case RC_FDOUB2:  *value = *(double *)buf;          break;
+        case RC_ISINGL:  *value = CDLISConvert::IbmValue(*(unsigned int *)buf);      break;
+        case RC_VSINGL:  *value = CDLISConvert::VaxValue(*(unsigned int *)buf);      break;
+        case RC_FSHORT:  *value = CDLISConvert::FshortValue(*(unsigned short *)buf); break;
+        case RC_SLONG:   *value = *(int *)buf;             break;
+        case RC_ULONG:   *value = *(unsigned int *)buf;    break;
+        case RC_SNORM:   *value = *(short *)buf;           break;
+        case RC_UNORM:   *value = *(unsigned short *)buf;  break;
+        case RC_SSHORT:  *value = *(signed char *)buf;     break;
+        default:         *value = *(byte *)buf;            break;
+    }
+
+    return true;
+}
+
+/*
+*  кадр подходит под запрос выборочного чтения (без запроса подходят все)
+*/
+bool CDLISParser::FrameRequestMatch(FrameData *frame, int number, const char *raw)
+{
+    double value;
+
+    if (!m_frame_request.frame)
+        return true;
+
+    if (m_frame_request.data != frame)
+        return false;
+
+    if (!m_frame_request.by_index)
+        return number >= m_frame_request.first && number < m_frame_request.last;
+
+    if (!ChannelValue(&frame->channels[0], raw, &value))
+        return false;
+
+    return value >= m_frame_request.index_from && value <= m_frame_request.index_to;
+}
+
+/*
+*  построение карты visible record: переходы по заголовкам позиционным чтением,
+*  данные записей не читаются, поэтому просмотр близок по стоимости к серии seek
+*/
+bool CDLISParser::ScanRecords(const wchar_t *file_name)
+{
+    CDLISFile  file;
+    bool       res;
+
+    m_record_map.Free();
+
+    if (!file_name)
+        return false;
+
+    if (!file.Open(file_name, CDLISFile::FILE_READ))
+        return false;
+
+    res = m_record_map.Build(&file);
+    file.Close();
+
+    return res;
+}
+
+
+bool CDLISParser::Parse(const void *data, size_t len)
+{
+    if (!data || !len)
+        return false;
+
+    FileClose();
+    m_memory_source.Attach(data, len);
+
+    return Parse(&m_memory_source);
+}
+
+
+bool CDLISParser::Parse(CDLISSource *source)
+{
+    if (!source)
+        return false;
+
+    m_source = source;
+
+    // незакрытый курсор не должен перехватывать пакеты callback
+    ParseEnd();
+
     // инициализация внутреннего буфера файла    
     if (!BufferInitialize())
         return false;
@@ -76,13 +674,109 @@ bool CDLISParser::Parse(const wchar_t *file_name)
     if (!ReadStorageUnitLabel())
         return false;
 
+    // преобразование кадров и callback - в отдельном потоке
+    if (m_pipeline_depth && m_notify_frame_func && !m_pipeline.Start(m_pipeline_depth, m_pipeline_threads, m_notify_frame_func, m_notify_params))
+        return false;
+
     // чтение данных DLIS
     if (!ReadLogicalFiles())
+    {
+        m_batch_data = NULL;
+        m_pipeline.Stop();
         return false;
+    }
 
+    // отдаем последний неполный пакет
+    FrameBatchFlush();
+    // дожидаемся преобразования всех переданных пакетов
+    m_pipeline.Stop();
+
+    return true;
+}
+
+bool CDLISParser::ParseBegin(const wchar_t *file_name)
+{
+    if (!file_name)
+        return false;
+
+    if (!FileOpen(file_name))
+        return false;
+
+    return ParseBegin(&m_file_source);
+}
+
+
+bool CDLISParser::ParseBegin(CDLISSource *source)
+{
+    if (!source)
+        return false;
+
+    m_source       = source;
+    m_cursor       = false;
+    m_cursor_ready = false;
+
+    if (!BufferInitialize())
+        return false;
+
+    if (!ReadStorageUnitLabel())
+        return false;
+
+    m_cursor = true;
     return true;
 }
 
+/*
+*  разбираем сегменты, пока не набран пакет: пакет заканчивается при наборе batch кадров
+*  или на IFLR другого фрейма; в конце файла отдаем последний неполный пакет
+*/
+CDLISFrame *CDLISParser::ParseNext(int batch, bool *error)
+{
+    *error = false;
+
+    if (!m_cursor)
+        return NULL;
+
+    m_cursor_batch = batch > 1 ? batch : 0;
+    m_cursor_ready = false;
+
+    while (!m_cursor_ready)
+    {
+        if (BufferIsEOF())
+        {
+            // отдаем последний неполный пакет
+            FrameBatchFlush();
+            m_cursor = false;
+            break;
+        }
+
+        if (!SegmentGet() || !SegmentProcess())
+        {
+            m_cursor     = false;
+            m_batch_data = NULL;
+            *error       = true;
+            return NULL;
+        }
+
+        // пакет набран по размеру (на смене фрейма он переносится внутри разбора)
+        if (!m_cursor_ready && m_batch_data && FrameBatchFull())
+            FrameBatchFlush();
+    }
+
+    return m_cursor_ready ? &m_frame_ready : NULL;
+}
+
+/*
+*  выход из разбора по запросу: недочитанный пакет отбрасывается, Parse снова отдает кадры в callback
+*/
+void CDLISParser::ParseEnd()
+{
+    m_cursor       = false;
+    m_cursor_ready = false;
+    m_cursor_batch = 0;
+    m_batch_data   = NULL;
+}
+
+
 bool CDLISParser::Initialize()
 {
     memset(&m_file_chunk, 0, sizeof(m_file_chunk)); 
@@ -107,10 +801,18 @@ bool CDLISParser::Initialize()
 
 void CDLISParser::Shutdown()
 {
+    m_pipeline.Stop();
+    // дерево разбора может ссылаться на память парсеров логических файлов
+    PartsFree();
+    BufferFree();
     FileClose();
+    m_index.Free();
+    m_value.Free();
+    m_frame.Shutdown();
+    m_frame_ready.Shutdown();
 
-    m_file_chunk.Free();
-    memset(&m_file_chunk, 0, sizeof(m_file_chunk));
+    m_cursor       = false;
+    m_cursor_ready = false;
 
     m_allocator.PullFreeAll();
     m_pull_id_strings = 0;
@@ -118,6 +820,7 @@ void CDLISParser::Shutdown()
     m_pull_id_frame_data = 0;
 
     m_frame_data = nullptr;
+    m_batch_data = nullptr;
 
     m_sets = nullptr;
     m_set_tail = nullptr;
@@ -135,10 +838,102 @@ void CDLISParser::Shutdown()
 }
 
 
-void CDLISParser::CallbackNotifyFrame(DlisNotifyCallback func, void *params)
+void CDLISParser::CallbackNotifyFrame(DlisNotifyCallback func, void *params)
+{
+    m_notify_frame_func = func;
+    m_notify_params     = params;
+}
+
+
+void CDLISParser::SetBatch(int frames, size_t bytes)
+{
+    m_batch_frames = frames > 1 ? frames : 0;
+    m_batch_bytes  = bytes;
+}
+
+
+void CDLISParser::SetPipeline(int depth, int threads)
+{
+    // пакет заполняется, пока предыдущий преобразуется: меньше двух пакетов конвейер не работает
+    m_pipeline_depth   = depth > 0 ? (depth < 2 ? 2 : depth) : 0;
+    m_pipeline_threads = threads > 1 ? threads : 1;
+}
+
+
+void CDLISParser::SetFileThreads(int threads)
+{
+    m_file_threads = threads > 1 ? threads : 1;
+}
+
+
+void CDLISParser::SetMapMode(bool map_mode)
+{
+    m_map_mode = map_mode;
+}
+
+
+void CDLISParser::SetReadAhead(int depth, size_t chunk_size)
+{
+    m_read_ahead_depth = depth > 0 ? depth : 0;
+    m_chunk_size       = chunk_size ? chunk_size : FILE_CHUNK;
+}
+
+
+void CDLISParser::SetCacheMode(CDLISFileSource::CacheMode mode)
+{
+    m_file_source.SetCacheMode(mode);
+}
+
+
+void CDLISParser::SetIndexDir(const wchar_t *dir)
+{
+    if (dir)
+        m_index_dir = dir;
+    else
+        m_index_dir.clear();
+}
+
+
+void CDLISParser::SetChannels(const char **names, int count)
+{
+    m_projection.clear();
+
+    for (int i = 0; names && i < count; i++)
+    {
+        ChannelKey key;
+
+        key.identifier       = names[i];
+        key.by_name          = true;
+        key.origin_reference = 0;
+        key.copy_number      = 0;
+
+        m_projection.push_back(key);
+    }
+
+    // уже построенные фреймы перестраиваем под новую проекцию
+    for (FrameData *frame = m_frame_data; frame; frame = frame->next)
+        FrameDataProject(frame);
+}
+
+
+void CDLISParser::SetChannels(const DlisValueObjName *names, int count)
 {
-    m_notify_frame_func = func;
-    m_notify_params     = params;
+    m_projection.clear();
+
+    for (int i = 0; names && i < count; i++)
+    {
+        ChannelKey key;
+
+        key.identifier       = names[i].identifier;
+        key.by_name          = false;
+        key.origin_reference = names[i].origin_reference;
+        key.copy_number      = names[i].copy_number;
+
+        m_projection.push_back(key);
+    }
+
+    for (FrameData *frame = m_frame_data; frame; frame = frame->next)
+        FrameDataProject(frame);
 }
 
 
@@ -353,59 +1148,80 @@ bool CDLISParser::FileOpen(const wchar_t *file_name)
 
     FileClose();
 
-    m_file = CreateFileW(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (m_file == INVALID_HANDLE_VALUE)
+    if (!m_file_source.Open(file_name))
         return false;
-        
+
     return true;
 }
 
 
 bool CDLISParser::FileClose()
 {
-    if (m_file != INVALID_HANDLE_VALUE)
-    {
-        CloseHandle(m_file);
-        m_file = INVALID_HANDLE_VALUE;
-    }
+    FileUnmap();
+    m_file_source.Close();
+
+    if (m_source == &m_file_source)
+        m_source = NULL;
+
     return true;
 }
 
 
-bool CDLISParser::FileRead(char *data, DWORD len)
+bool CDLISParser::FileRead(char *data, size_t len, size_t *readed)
 {
-    BOOL  r;
-    DWORD readed = 0;
+    // данные уже вычитаны потоком упреждающего чтения
+    if (m_read_ahead.IsStarted())
+        return m_read_ahead.Read(data, len, readed);
 
-    r = ReadFile(m_file, data, len, &readed, NULL);
-    if (r == FALSE)
-        return false;
-    
-    if (readed != len)
+    return m_source->Read(data, len, readed);
+}
+
+/*
+*  отображаем весь файл в память, данные отдаются указателями прямо в отображение
+*/
+bool CDLISParser::FileMap()
+{
+    char     *view;
+    UINT64    size;
+
+    if (!m_source->Map(&view, &size))
         return false;
 
+    m_file_chunk.data         = view;
+    m_file_chunk.size         = (size_t)size;
+    m_file_chunk.max_size     = (size_t)size;
+    m_file_chunk.size_chunk   = (size_t)size;
+    m_file_chunk.remaind      = (size_t)size;
+    m_file_chunk.pos          = 0;
+    m_file_chunk.file_remaind = 0;
+    m_file_chunk.mapped       = true;
+    m_file_chunk.advise_pos   = 0;
+
     return true;
 }
 
 
-UINT64 CDLISParser::FileSize()
+void CDLISParser::FileUnmap()
 {
-    UINT64   size;
-    DWORD    high_size = 0;
-    DWORD    low_size;
-
-    low_size = GetFileSize(m_file, &high_size);
-     
-    if (high_size)
-    {
-        size = ((UINT64)high_size << 32) & 0xFFFFFFFF00000000 | ((UINT64)low_size & 0xFFFFFFFF);
-    }
-    else
+    if (m_file_chunk.mapped)
     {
-        size = (size_t)low_size;
+        m_source->Unmap();
+        memset(&m_file_chunk, 0, sizeof(m_file_chunk));
     }
+}
+
+/*
+*  подсказка системе: окно отображения [pos, pos + len) понадобится в ближайшее время
+*/
+void CDLISParser::FileAdvise(size_t pos, size_t len)
+{
+    if (pos >= m_file_chunk.size)
+        return;
 
-    return size;
+    if (len > m_file_chunk.size - pos)
+        len = m_file_chunk.size - pos;
+
+    m_source->Prefetch(m_file_chunk.data + pos, len);
 }
 
 
@@ -473,17 +1289,52 @@ void CDLISParser::Big2LittelEndianByte(byte *bt)
 */
 bool CDLISParser::BufferNext(char **data, size_t len)
 {
-    // если в буфере есть требуемой длины размер, копируем и выходим
-    if (len <= m_file_chunk.remaind)      
+    // данных в буфере не хватает, читаем следующую порцию
+    if (len > m_file_chunk.remaind)
+    {
+        if (!BufferFill(len))
+            return false;
+
+        // если не получается, значит файл закончился или поврежден
+        if (len > m_file_chunk.remaind)
+            return false;
+    }
+
+    // в буфере есть требуемой длины размер, отдаем указатель на данные
+    *data = m_file_chunk.data + m_file_chunk.pos;
+
+    m_file_chunk.pos       += len;
+    m_file_chunk.remaind   -= len;
+
+    // в режиме отображения заранее подкачиваем следующее окно файла
+    if (m_file_chunk.mapped && m_file_chunk.pos >= m_file_chunk.advise_pos)
     {
-        *data = m_file_chunk.data + m_file_chunk.pos;
+        FileAdvise(m_file_chunk.pos, MAP_PREFETCH);
+        m_file_chunk.advise_pos = m_file_chunk.pos + MAP_PREFETCH / 2;
+    }
+    return true;
+}
 
-        m_file_chunk.pos       += len;
-        m_file_chunk.remaind   -= len;
+/*
+*  дочитываем из источника порцию данных, в буфере должно оказаться не меньше len байт
+*  (меньше - только в конце данных)
+*/
+bool CDLISParser::BufferFill(size_t len)
+{
+    // отображение содержит весь файл, дочитывать нечего
+    if (m_file_chunk.mapped || m_file_chunk.file_remaind == 0)
         return true;
+
+    // буферы упреждающего чтения забираем целиком, копируем только на стыке больше буфера
+    if (m_read_ahead.IsStarted())
+    {
+        if (!BufferSwap(len))
+            return false;
+
+        if (len <= m_file_chunk.remaind || m_file_chunk.file_remaind == 0)
+            return true;
     }
 
-    // данных не хватило, читаем следующую порцию данных
     // если есть остаток данных, копируем его в начало буфера
     if (m_file_chunk.remaind) 
     {
@@ -498,48 +1349,181 @@ bool CDLISParser::BufferNext(char **data, size_t len)
     else
         m_file_chunk.size = 0;
 
+    m_file_chunk.base += m_file_chunk.pos;
+    m_file_chunk.pos   = 0;
+    m_file_chunk.begin = 0;
 
 
-    DWORD   amout;
-    // высчитаем правильный остаток данный который нужно вычитать из файла
-    if (FILE_CHUNK > (DWORD)m_file_chunk.file_remaind)
-        amout = (DWORD)m_file_chunk.file_remaind;
+    size_t  amout;
+    size_t  chunk = m_chunk_size;
+    // порция чтения не может быть меньше запрошенных данных
+    if (len > m_file_chunk.remaind && chunk < len - m_file_chunk.remaind)
+        chunk = len - m_file_chunk.remaind;
+    // высчитаем правильный остаток данный который нужно вычитать из файла,
+    // сравниваем в 64-х битах: остаток файла может быть больше 4 Гб
+    if ((UINT64)chunk > m_file_chunk.file_remaind)
+        amout = (size_t)m_file_chunk.file_remaind;
     else
-        amout = FILE_CHUNK;
+        amout = chunk;
 
     // резервируем память под новые данные
     if (!m_file_chunk.Resize(amout + m_file_chunk.remaind))
         return false;
     // вычитываем данные
-    if (!FileRead(m_file_chunk.data + m_file_chunk.remaind, amout))
+    size_t  readed = 0;
+
+    if (!FileRead(m_file_chunk.data + m_file_chunk.remaind, amout, &readed))
         return false; 
-    // изменим счетчик
-    m_file_chunk.file_remaind -= amout;
-    m_file_chunk.remaind      += amout;
-    m_file_chunk.pos           = 0;
+    // изменим счетчик, источник закончился раньше - это конец потока
+    if (readed < amout)
+        m_file_chunk.file_remaind  = 0;
+    else
+        m_file_chunk.file_remaind -= amout;
+    m_file_chunk.remaind      += readed;
     m_file_chunk.size_chunk    = m_file_chunk.remaind;
-    
-    // отдаем данные размера len, 
-    if (len <= m_file_chunk.remaind)      
+
+    return true;
+}
+
+
+/*
+*  забираем заполненные буферы упреждающего чтения вместо копирования из них: остаток текущего
+*  (короче visible record) переносится в запас перед данными, текущий уходит потоку-читателю
+*/
+bool CDLISParser::BufferSwap(size_t len)
+{
+    size_t  pos, readed;
+
+    while (len > m_file_chunk.remaind && m_file_chunk.file_remaind && m_file_chunk.remaind <= READ_AHEAD_HEAD)
     {
-        *data = m_file_chunk.data;
+        if (!m_read_ahead.Swap(&m_file_chunk, m_file_chunk.pos, m_file_chunk.remaind, &pos, &readed))
+            return false;
 
-        m_file_chunk.pos      += len;
-        m_file_chunk.remaind  -= len;
-        return true;
+        // поток-читатель дошел до конца данных
+        if (readed == 0)
+        {
+            m_file_chunk.file_remaind = 0;
+            break;
+        }
+
+        // остаток был с pos прежнего буфера, теперь - с pos нового
+        m_file_chunk.base       += m_file_chunk.pos - pos;
+        m_file_chunk.pos         = pos;
+        m_file_chunk.begin       = pos;
+        m_file_chunk.remaind    += readed;
+        m_file_chunk.size_chunk  = m_file_chunk.remaind;
+
+        if ((UINT64)readed < m_file_chunk.file_remaind)
+            m_file_chunk.file_remaind -= readed;
+        else
+            m_file_chunk.file_remaind  = 0;
     }
 
-    // если не получается, значит произошла ошибка
-    return false;
+    return true;
+}
+
+
+bool CDLISParser::BufferInitialize(bool read_ahead)
+{
+    BufferFree();
+
+    // недочитанные visible record и сегмент (курсор закрыт раньше конца) указывают в прежний буфер
+    memset(&m_visible_record, 0, sizeof(m_visible_record));
+    memset(&m_segment, 0, sizeof(m_segment));
+
+    // если файл удалось отобразить (или образ уже в памяти), буфер чтения не нужен
+    if ((m_map_mode || m_source->InMemory()) && FileMap())
+        return true;
+
+    // размер потока заранее неизвестен, читаем до конца данных
+    if (!m_source->Size(&m_file_chunk.file_remaind))
+        m_file_chunk.file_remaind = (UINT64)-1;
+
+    if (read_ahead)
+        return BufferReadAhead();
+
+    return true;
+}
+
+/*
+*  чтение с диска идет в отдельном потоке параллельно с разбором, в конвейере - всегда (первая стадия):
+*  с текущей позиции источника до конца данных буфера
+*/
+bool CDLISParser::BufferReadAhead()
+{
+    int depth = m_read_ahead_depth;
+
+    if (depth == 0 && m_pipeline_depth)
+        depth = PIPELINE_READ_AHEAD;
+
+    if (m_file_chunk.mapped || depth == 0)
+        return true;
+
+    return m_read_ahead.Start(m_source, m_file_chunk.file_remaind, depth, m_chunk_size, READ_AHEAD_HEAD);
 }
 
 
-bool CDLISParser::BufferInitialize()
+void CDLISParser::BufferFree()
 {
-    m_file_chunk.Free();
+    m_read_ahead.Stop();
+
+    if (m_file_chunk.mapped)
+        FileUnmap();
+    else
+        m_file_chunk.Free();
+
     memset(&m_file_chunk, 0, sizeof(m_file_chunk));
+}
+
+/*
+*  переход на смещение offset источника: внутри уже прочитанных данных - без обращения к источнику
+*/
+bool CDLISParser::BufferSeek(UINT64 offset)
+{
+    size_t  filled;
+    UINT64  index;
+    UINT64  size;
+
+    // данные текущей visible record больше не действительны
+    m_visible_record.current = NULL;
+    m_visible_record.end     = NULL;
+    m_visible_record.len     = 0;
+
+    if (m_file_chunk.mapped)
+    {
+        if (offset > m_file_chunk.size)
+            return false;
+
+        m_file_chunk.pos     = (size_t)offset;
+        m_file_chunk.remaind = m_file_chunk.size - m_file_chunk.pos;
+        return true;
+    }
+
+    // разность по модулю 2^64: смещение до начала данных дает индекс меньше begin или огромный
+    filled = m_file_chunk.pos + m_file_chunk.remaind;
+    index  = offset - m_file_chunk.base;
+    if (index >= m_file_chunk.begin && index <= filled)
+    {
+        m_file_chunk.pos     = (size_t)index;
+        m_file_chunk.remaind = filled - m_file_chunk.pos;
+        return true;
+    }
+
+    // упреждающее чтение идет только вперед, дальше читаем сами
+    m_read_ahead.Stop();
+
+    if (!m_source->Size(&size) || offset > size)
+        return false;
+
+    if (!m_source->Seek(offset))
+        return false;
+
+    m_file_chunk.base         = offset;
+    m_file_chunk.begin        = 0;
+    m_file_chunk.pos          = 0;
+    m_file_chunk.remaind      = 0;
+    m_file_chunk.file_remaind = size - offset;
 
-    m_file_chunk.file_remaind = FileSize();
     return true;
 }
 
@@ -551,6 +1535,11 @@ bool CDLISParser::BufferIsEOF()
     bool r;
     
     r = m_visible_record.end <= m_visible_record.current;
+
+    // у потока неизвестного размера конец данных узнаем только попыткой чтения
+    if (r && m_file_chunk.remaind == 0 && m_file_chunk.file_remaind)
+        BufferFill(1);
+
     if (r)
         r = m_file_chunk.remaind == 0 && m_file_chunk.file_remaind == 0;
 
@@ -576,6 +1565,15 @@ bool CDLISParser::SegmentGet()
     //  получим полный размер сегмента и его атрибуты
     Big2LittelEndian(&(m_segment_header.length), sizeof(m_segment_header.length));
     Big2LittelEndianByte(&m_segment_header.attributes);
+
+    // начало логической записи попадает в индекс
+    if (m_index_build && SegmentFirst(&m_segment_header))
+    {
+        char *begin = m_visible_record.end - m_visible_record.len;
+
+        m_index.RecordAdd(m_visible_record.offset, (unsigned short)(m_visible_record.current - begin), 
+                          m_segment_header.type, m_segment_header.attributes);
+    }
     
 
     short  size_header = (short)(offsetof(SegmentHeader, length_data));
@@ -671,15 +1669,17 @@ bool CDLISParser::VisibleRecordNext()
     m_visible_record.len     = 0;    
 
     char                 *data;
-    VisibleRecordHeader  *header;
+    VisibleRecordHeader   header;
 
-    // читаем заголовок
+    m_visible_record.offset = m_file_chunk.base + m_file_chunk.pos;
+
+    // читаем заголовок, копируем его т.к. буфер может быть только для чтения (отображение файла)
     bool r = BufferNext(&data, sizeof(VisibleRecordHeader));
 
     if (r) 
     {
-        header = (VisibleRecordHeader *)data;
-        Big2LittelEndian(&((*header).length), sizeof(header->length));
+        header = *(VisibleRecordHeader *)data;
+        Big2LittelEndian(&header.length, sizeof(header.length));
     }
 
     // читаем visible record размером указанным в заголовке 
@@ -687,7 +1687,7 @@ bool CDLISParser::VisibleRecordNext()
     {
         char *record;
         
-        m_visible_record.len = header->length - sizeof(VisibleRecordHeader);
+        m_visible_record.len = header.length - sizeof(VisibleRecordHeader);
         r = BufferNext(&record, m_visible_record.len);            
 
         if (r)
@@ -739,6 +1739,141 @@ bool CDLISParser::ReadLogicalFiles()
     return r;
 }
 
+/*
+*  читаем логическую запись (или серию записей) по ее положению из индекса
+*/
+bool CDLISParser::ReadLogicalRecord(const CDLISIndex::Record *record)
+{
+    bool r;
+
+    r = BufferSeek(record->vr_offset);
+    if (r)
+        r = VisibleRecordNext();
+
+    if (r)
+    {
+        if (record->segment_pos >= m_visible_record.len)
+            return false;
+
+        m_visible_record.current += record->segment_pos;
+    }
+
+    // сегменты записи, продолжения могут лежать в следующих visible record,
+    // записи серии идут в файле подряд
+    for (UINT i = 0; r && i < record->count; i++)
+    {
+        while (r)
+        {
+            r = SegmentGet();
+
+            if (r)
+                r = SegmentProcess();
+
+            if (r && SegmentLast(&m_segment_header))
+                break;
+        }
+    }
+
+    return r;
+}
+
+/*
+*  разбор по индексу: метаданные (EFLR) читаем по смещениям, IFLR пропускаем
+*/
+bool CDLISParser::ReadIndexed()
+{
+    bool r;
+
+    r = BufferInitialize(false);
+    if (r)
+        r = ReadStorageUnitLabel();
+
+    for (size_t i = 0; r && i < m_index.RecordCount(); i++)
+    {
+        const CDLISIndex::Record *record = m_index.RecordGet(i);
+
+        if (CDLISIndex::IsExplicit(record))
+            r = ReadLogicalRecord(record);
+    }
+
+    return r;
+}
+
+/*
+*  разделитель каталогов в пути: в Windows допустимы оба, в POSIX '\\' - обычный символ имени
+*/
+static bool IsPathSeparator(wchar_t ch)
+{
+#if defined(_WIN32)
+    return ch == L'\\' || ch == L'/';
+#else
+    return ch == L'/';
+#endif
+}
+
+/*
+*  имя файла индекса: <путь к файлу DLIS>.idx или <каталог>/<имя файла DLIS>.idx, если каталог задан
+*/
+void CDLISParser::IndexName(const wchar_t *file_name, std::wstring *index_name)
+{
+    const wchar_t *name;
+
+    if (m_index_dir.empty())
+    {
+        *index_name = file_name;
+    }
+    else
+    {
+        name = file_name;
+        for (const wchar_t *ch = file_name; *ch; ch++)
+            if (IsPathSeparator(*ch))
+                name = ch + 1;
+
+        *index_name = m_index_dir;
+        if (!IsPathSeparator(index_name->back()))
+#if defined(_WIN32)
+            *index_name += L'\\';
+#else
+            *index_name += L'/';
+#endif
+        *index_name += name;
+    }
+
+    *index_name += L".idx";
+}
+
+/*
+*  порядковый номер логического файла (корневого набора FHLR)
+*/
+int CDLISParser::LogicalFileIndex(const DlisSet *root)
+{
+    int index = 0;
+
+    for (DlisSet *next = m_sets; next; next = next->next, index++)
+        if (next == root)
+            return index;
+
+    return -1;
+}
+
+/*
+*  логический файл, которому принадлежит набор set
+*/
+DlisSet *CDLISParser::LogicalFileFind(const DlisSet *set)
+{
+    for (DlisSet *root = m_sets; root; root = root->next)
+    {
+        if (root == set)
+            return root;
+
+        for (DlisSet *child = root->childs; child; child = child->next)
+            if (child == set)
+                return root;
+    }
+
+    return NULL;
+}
+
 /*
 * читаем компонет DLIS и обрабатываем его 
 */
@@ -834,16 +1969,13 @@ bool CDLISParser::ReadRawData(void *dst, size_t len)
 }
 
 /*
-* вычитываем данные по representation code
+* вычитываем значение по representation code, код известен только во время разбора
+* (значения атрибутов); данные остаются в буфере m_value до следующего чтения
 */
 bool CDLISParser::ReadCodeSimple(RepresentationCodes code, void **dst, size_t *len)
 {
-    // резервируем данные для быстрого доступа 8 килобайт
-    static byte buf[8 * Kb] = { 0 };
     int    type_len;
 
-    memset(&buf[0], 0, sizeof(buf));
-
     // получаем размер representation code
     type_len = s_rep_codes_length[code - 1].length;
 
@@ -854,7 +1986,12 @@ bool CDLISParser::ReadCodeSimple(RepresentationCodes code, void **dst, size_t *l
     // если размер известен, просто копируем их в буфер и выходим
     if (type_len > 0)
     {
-        ReadRawData(buf, type_len);
+        if (!m_value.Resize(type_len))
+            return false;
+
+        if (!ReadRawData(m_value.data, type_len))
+            return false;
+
         switch(code)
         {
             case  RC_SSHORT: 
@@ -865,14 +2002,14 @@ bool CDLISParser::ReadCodeSimple(RepresentationCodes code, void **dst, size_t *l
             case  RC_ULONG:  
             case  RC_FSINGL:
             case  RC_FDOUBL:
-                Big2LittelEndian(buf, type_len);
+                Big2LittelEndian(m_value.data, type_len);
                 break;
 
             default:
                 break;
         }
         
-        *dst = buf;
+        *dst = m_value.data;
         *len = type_len;
 
         return true;
@@ -884,68 +2021,93 @@ bool CDLISParser::ReadCodeSimple(RepresentationCodes code, void **dst, size_t *l
         case RC_IDENT:
         case RC_ASCII:
         case RC_UNITS:
+            return ReadString(code, (char **)dst, len);
+
+        case RC_UVARI:
+        case RC_ORIGIN:
             {
-                size_t   count;
-                void    *ptr;
-                UINT     str_len = 0;
-                // в зависимости от code сначала читаем размер данных  
-                if (code == RC_ASCII)
-                    ReadCodeSimple(RC_UVARI,  &ptr, &count);
-                else
-                    ReadCodeSimple(RC_USHORT, &ptr, &count);
+                UINT  value;
 
-                // получаем размер данных в байтах
-                assert(count <= sizeof(str_len));
-                memcpy(&str_len, ptr, count);
-                // читаем сами данные
-                ReadRawData(buf, str_len);
+                if (!ReadUvari(&value, len))
+                    return false;
+                // значение в little endian, занимает столько же байт, сколько в файле
+                if (!m_value.Resize(sizeof(value)))
+                    return false;
 
-                *len = str_len;
-                *dst = StringTrim((char *)buf, len);
+                memcpy(m_value.data, &value, *len);
+                *dst = m_value.data;
             }
             break;
 
-        case RC_UVARI:
-        case RC_ORIGIN:
-            {
-                byte  var_len;
+        default:
+            assert(false);
+            return false;
+    }
+
+    return true;
+}
 
-                // определим размер данных
-                // верхние 2 бита определяют полное количество байт которое надо считать,
-                // в 6 нижних, лежат данные 
-                memset(&buf[0], 0, sizeof(buf));
-                ReadRawData(buf, 1);
+/*
+* читаем UVARI (ORIGIN): верхние 2 бита первого байта определяют полное количество байт (1, 2 или 4),
+* в остальных битах лежит само значение в big endian
+*/
+bool CDLISParser::ReadUvari(UINT *value, size_t *len)
+{
+    byte   buf[4];
+    size_t var_len;
 
-                // определим полный размер в байтах который нужно считать               
-                if ((*buf & 0xC0) == 0xC0)
-                {
-                    var_len = 4;
-                    buf[0] &= ~0xC0;
-                }
-                else if ((*buf & 0x80) == 0x80)
-                {
-                    var_len = 2;
-                    buf[0] &= ~0x80;
-                }
-                else
-                    var_len = 1;
+    if (!ReadRawData(buf, 1))
+        return false;
+
+    var_len = UvariLength(buf[0]);
+    if (var_len > 1 && !ReadRawData(&buf[1], var_len - 1))
+        return false;
+
+    switch (var_len)
+    {
+        case 4:  *value = ((buf[0] & 0x3F) << 24) | (buf[1] << 16) | (buf[2] << 8) | buf[3]; break;
+        case 2:  *value = ((buf[0] & 0x7F) << 8) | buf[1];                                 break;
+        default: *value = buf[0];                                                           break;
+    }
+
+    *len = var_len;
+    return true;
+}
+
+/*
+* читаем строку: у IDENT и UNITS длина задана USHORT, у ASCII - UVARI;
+* строка размещается в буфере m_value и обрезается по пробелам
+*/
+bool CDLISParser::ReadString(RepresentationCodes code, char **str, size_t *len)
+{
+    UINT   str_len;
+    size_t var_len;
+
+    if (code == RC_ASCII)
+    {
+        if (!ReadUvari(&str_len, &var_len))
+            return false;
+    }
+    else
+    {
+        unsigned char short_len;
+
+        if (!ReadCode<RC_USHORT>(&short_len))
+            return false;
+
+        str_len = short_len;
+    }
 
-                // дочитаем данные
-                if (var_len > 1)
-                    ReadRawData(&buf[1], var_len - 1);
+    if (!m_value.Resize(str_len + 1))
+        return false;
 
-                // конвертируем считанные данные 
-                Big2LittelEndian(buf, var_len);
+    if (!ReadRawData(m_value.data, str_len))
+        return false;
 
-                *len = var_len;
-                *dst = buf;
-            }
-            break;
+    m_value.data[str_len] = 0;
 
-        default:
-            assert(false);
-            break;
-    }
+    *len = str_len;
+    *str = StringTrim(m_value.data, len);
 
     return true;
 }
@@ -965,13 +2127,17 @@ bool CDLISParser::ReadCodeComplex(RepresentationCodes code, void *dst)
                 DlisValueObjName  *value;
                 value = (DlisValueObjName *)dst;
 
-                ReadCodeSimple(RC_ORIGIN, (void **)&src, &len);
-                memcpy(&value->origin_reference, src, len);
+                UINT          origin;
+                unsigned char copy_number;
 
-                ReadCodeSimple(RC_USHORT, (void **)&src, &len);
-                memcpy(&value->copy_number, src, len); 
+                if (!ReadUvari(&origin, &len) || !ReadCode<RC_USHORT>(&copy_number))
+                    return false;
 
-                ReadCodeSimple(RC_IDENT, (void **)&src, &len);
+                value->origin_reference = origin;
+                value->copy_number      = copy_number;
+
+                if (!ReadString(RC_IDENT, &src, &len))
+                    return false;
                 value->identifier = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
 
                 strcpy_s(value->identifier, len + 1, src);
@@ -983,7 +2149,8 @@ bool CDLISParser::ReadCodeComplex(RepresentationCodes code, void *dst)
                 DlisValueObjRef  *value;
                 value = (DlisValueObjRef *)dst;
 
-                ReadCodeSimple(RC_IDENT, (void **)&src, &len);
+                if (!ReadString(RC_IDENT, &src, &len))
+                    return false;
                 value->object_type = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
                 strcpy_s(value->object_type, len + 1, src);
 
@@ -996,13 +2163,15 @@ bool CDLISParser::ReadCodeComplex(RepresentationCodes code, void *dst)
                 DlisValueAttRef  *value;
                 value = (DlisValueAttRef *)dst;
 
-                ReadCodeSimple(RC_IDENT, (void **)&src, &len);
+                if (!ReadString(RC_IDENT, &src, &len))
+                    return false;
                 value->object_type = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
                 strcpy_s(value->object_type, len + 1, src);
                 
                 ReadCodeComplex(RC_OBNAME,(void **)&value->object_name);
 
-                ReadCodeSimple(RC_IDENT, (void **)&src, &len);
+                if (!ReadString(RC_IDENT, &src, &len))
+                    return false;
                 value->attribute_label = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
                 strcpy_s(value->attribute_label, len + 1, src);
             }
@@ -1020,32 +2189,44 @@ bool CDLISParser::ReadCodeComplex(RepresentationCodes code, void *dst)
 */
 bool CDLISParser::ReadIndirectlyFormattedLogicalRecord()
 {                
-    static char       buf[128];
+    char              buf[256];
     char             *src;
-    size_t            len, len_str;
+    size_t            len;
+    UINT              origin;
+    unsigned char     copy_number;
     DlisValueObjName  obj_name = { 0 };
     
 
-    ReadCodeSimple(RC_ORIGIN, (void **)&src, &len);
-    memcpy(&obj_name.origin_reference, src, len);
+    if (!ReadUvari(&origin, &len) || !ReadCode<RC_USHORT>(&copy_number))
+        return false;
 
-    ReadCodeSimple(RC_USHORT, (void **)&src, &len);
-    memcpy(&obj_name.copy_number, src, len); 
+    obj_name.origin_reference = origin;
+    obj_name.copy_number      = copy_number;
 
-    ReadCodeSimple(RC_IDENT, (void **)&src, &len_str);
-    strcpy_s(buf, len_str + 1, src);
+    // IDENT не длиннее 255 символов
+    if (!ReadString(RC_IDENT, &src, &len))
+        return false;
+    strcpy_s(buf, len + 1, src);
     obj_name.identifier = buf;
 
 
     FrameData *frame;
 
-    frame = FrameDataFind(&obj_name);
+    frame = FrameDataFind(&obj_name, m_last_root_set);
     if (!frame)
-    {    
         frame = FrameDataBuild(&obj_name);
-        if (!frame)
-            return false;
+    // фрейм не описан в текущем логическом файле, берем одноименный из предыдущих
+    if (!frame)
+    {
+        frame = FrameDataFind(&obj_name, NULL);
+        if (frame)
+            frame = FrameDataLink(frame);
     }
+    // при параллельном разборе предыдущие логические файлы - у парсеров других участков
+    if (!frame && m_part_owner)
+        frame = FrameDataFindPrevious(&obj_name);
+    if (!frame)
+        return false;
 
     if (!FrameDataParse(frame))
         return true;
@@ -1064,13 +2245,15 @@ bool CDLISParser::ReadAttributeValue(DlisValue *attr_val, RepresentationCodes co
 
     if (type > 0)
     {
-        ReadCodeSimple(code, (void **)&val, &len);
+        if (!ReadCodeSimple(code, (void **)&val, &len))
+            return false;
         attr_val->data = m_allocator.MemoryGet(m_pull_id_strings, type);
         memcpy(attr_val->data, val, len);
     }
     else if (type == REP_CODE_VARIABLE_SIMPLE)
     {
-        ReadCodeSimple(code, (void **)&val, &len);
+        if (!ReadCodeSimple(code, (void **)&val, &len))
+            return false;
         switch(code)
         {
             case RC_UVARI:
@@ -1307,6 +2490,8 @@ CDLISParser::FrameData *CDLISParser::FrameDataBuild(DlisValueObjName *obj_name)
             return NULL;
 
         channels->code = (RepresentationCodes) AttrGetInt(found);
+        if (channels->code < RC_FSHORT || channels->code > RC_LAST)
+            return NULL;
 
         found = FindAttribute(obj_channel, "DIMENSION");
         if (!found)
@@ -1315,12 +2500,17 @@ CDLISParser::FrameData *CDLISParser::FrameDataBuild(DlisValueObjName *obj_name)
         channels->dimension    = (short) AttrGetInt(found);
         channels->element_size = s_rep_codes_length[channels->code - 1].length;
 
-        if (channels == frame_data->channels)
+        // после первого канала переменной длины смещения известны только в конкретном кадре
+        if (channels->element_size <= 0)
+            frame_data->variable = true;
+
+        if (channels == frame_data->channels || frame_data->variable)
             channels->offsets = 0;
         else
             channels->offsets = (channels - 1)->offsets + (channels - 1)->dimension * (channels - 1)->element_size;
 
-        frame_data->len += s_rep_codes_length[channels->code - 1].length * channels->dimension;
+        if (!frame_data->variable)
+            frame_data->len += channels->element_size * channels->dimension;
 
         // next element 
         frame_data->channel_count++;
@@ -1338,8 +2528,321 @@ CDLISParser::FrameData *CDLISParser::FrameDataBuild(DlisValueObjName *obj_name)
     frame_data->obj_key.identifier       = m_allocator.MemoryGet(m_pull_id_frame_data, len + 1);
     strcpy_s(frame_data->obj_key.identifier, len + 1, obj_name->identifier);
 
+    frame_data->root  = m_last_root_set;
+    frame_data->index = m_index.FrameFind(&frame_data->obj_key, LogicalFileIndex(m_last_root_set));
+    if (frame_data->index == CDLISIndex::NO_FRAME && m_index_build)
+        frame_data->index = m_index.FrameAdd(&frame_data->obj_key, LogicalFileIndex(m_last_root_set));
+
+    if (!FrameDataProject(frame_data))
+        return NULL;
+
+
+    FrameDataAdd(frame_data);
+
+    return frame_data; 
+}
+
+/*
+*  описание фрейма из другого логического файла, закрепляем его за текущим, 
+*  чтобы следующие IFLR находили его сразу
+*/
+CDLISParser::FrameData *CDLISParser::FrameDataLink(FrameData *src)
+{
+    FrameData   *frame_data;
+
+    frame_data = (FrameData *)m_allocator.MemoryGet(m_pull_id_frame_data, sizeof(FrameData));
+    if (!frame_data)
+        return NULL;
+
+    *frame_data = *src;
+    frame_data->root = m_last_root_set;
+    frame_data->next = NULL;
+
+    FrameDataAdd(frame_data);
+
+    return frame_data;
+}
+
+
+/*
+*  параллельный разбор: фрейм ищем у участков до текущего, дождавшись окончания их разбора.
+*  Участки раздаются потокам по порядку, поэтому предыдущие уже разбираются и ожидание конечно
+*/
+CDLISParser::FrameData *CDLISParser::FrameDataFindPrevious(DlisValueObjName *obj_name)
+{
+    FrameData *frame = NULL;
+
+    for (size_t i = 0; i < m_part_index; i++)
+        for (int spin = 0; !m_part_owner->m_parts[i]->m_part_done; spin++)
+            CDLISQueue<FrameData *>::Wait(spin);
+
+    // первый подходящий в порядке файла, как FrameDataFind при последовательном разборе
+    for (size_t i = 0; i < m_part_index && !frame; i++)
+        frame = m_part_owner->m_parts[i]->FrameDataFind(obj_name, NULL);
+
+    return frame ? FrameDataLink(frame) : NULL;
+}
+
+
+/*
+*  план разбора кадра под проекцию: выбранные каналы с новыми смещениями в строке хранилища
+*  и участки исходного кадра, которые в нее копируются
+*/
+bool CDLISParser::FrameDataProject(FrameData *frame_data)
+{
+    DlisChannelInfo  *selected;
+    FrameRange       *ranges;
+    int               count = 0, range_count = 0;
+    size_t            len   = 0;
+
+    // без проекции строка хранилища совпадает с кадром
+    if (m_projection.empty())
+    {
+        frame_data->selected_index = NULL;
+
+        ranges = (FrameRange *)m_allocator.MemoryGet(m_pull_id_frame_data, sizeof(FrameRange));
+        if (!ranges)
+            return false;
+
+        ranges->src = 0;
+        ranges->dst = 0;
+        ranges->len = frame_data->len;
+
+        frame_data->selected       = frame_data->channels;
+        frame_data->selected_count = frame_data->channel_count;
+        frame_data->selected_len   = frame_data->len;
+        frame_data->ranges         = ranges;
+        frame_data->range_count    = 1;
+
+        return true;
+    }
+
+    selected = (DlisChannelInfo *)m_allocator.MemoryGet(m_pull_id_frame_data, sizeof(DlisChannelInfo) * (frame_data->channel_count + 1));
+    ranges   = (FrameRange *)m_allocator.MemoryGet(m_pull_id_frame_data, sizeof(FrameRange) * (frame_data->channel_count + 1));
+    frame_data->selected_index = (int *)m_allocator.MemoryGet(m_pull_id_frame_data, sizeof(int) * (frame_data->channel_count + 1));
+    if (!selected || !ranges || !frame_data->selected_index)
+        return false;
+
+    for (int i = 0; i < frame_data->channel_count; i++)
+    {
+        DlisChannelInfo  *channel = &frame_data->channels[i];
+        size_t            size;
+
+        if (!ChannelSelected(channel))
+            continue;
+
+        size = (size_t)channel->dimension * channel->element_size;
+
+        frame_data->selected_index[count] = i;
+
+        selected[count]         = *channel;
+        selected[count].offsets = len;
+        count++;
+
+        // у кадра переменной длины участки копирования определяются в каждом кадре
+        if (frame_data->variable)
+            continue;
+
+        // канал продолжает предыдущий участок - расширяем его
+        if (range_count > 0 && ranges[range_count - 1].src + ranges[range_count - 1].len == channel->offsets)
+        {
+            ranges[range_count - 1].len += size;
+        }
+        else
+        {
+            ranges[range_count].src = channel->offsets;
+            ranges[range_count].dst = len;
+            ranges[range_count].len = size;
+            range_count++;
+        }
+
+        len += size;
+    }
+
+    frame_data->selected       = selected;
+    frame_data->selected_count = count;
+    frame_data->selected_len   = (int)len;
+    frame_data->ranges         = ranges;
+    frame_data->range_count    = range_count;
+
+    return true;
+}
+
+
+bool CDLISParser::ChannelSelected(const DlisChannelInfo *channel)
+{
+    for (size_t i = 0; i < m_projection.size(); i++)
+    {
+        const ChannelKey *key = &m_projection[i];
+
+        if (strcmp(key->identifier.c_str(), channel->obj_name->identifier) != 0)
+            continue;
+
+        if (key->by_name)
+            return true;
+
+        if (key->origin_reference == channel->obj_name->origin_reference && key->copy_number == channel->obj_name->copy_number)
+            return true;
+    }
+
+    return false;
+}
+
+/*
+*  кадр переменной длины собираем в m_value, запоминая начало значений каждого канала
+*  (последний элемент m_channel_offsets - длина кадра)
+*/
+bool CDLISParser::FrameReadVariable(FrameData *frame)
+{
+    m_value.size = 0;
+    m_channel_offsets.resize(frame->channel_count + 1);
+
+    for (int i = 0; i < frame->channel_count; i++)
+    {
+        DlisChannelInfo *channel = &frame->channels[i];
+
+        m_channel_offsets[i] = (int)m_value.size;
+
+        // значения фиксированной длины читаем одним блоком
+        if (channel->element_size > 0)
+        {
+            if (!ValueAppend((size_t)channel->element_size * channel->dimension))
+                return false;
+            continue;
+        }
+
+        for (int k = 0; k < channel->dimension; k++)
+            if (!ValueReadRaw(channel->code))
+                return false;
+    }
+
+    m_channel_offsets[frame->channel_count] = (int)m_value.size;
+    return true;
+}
+
+/*
+*  дочитываем len байт кадра в конец m_value
+*/
+bool CDLISParser::ValueAppend(size_t len)
+{
+    if (!m_value.Resize(m_value.size + len))
+        return false;
+
+    if (!ReadRawData(m_value.data + m_value.size, len))
+        return false;
+
+    m_value.size += len;
+    return true;
+}
+
+/*
+*  одно значение переменной длины в кодировке файла: длину определяем по его префиксам
+*/
+bool CDLISParser::ValueReadRaw(RepresentationCodes code)
+{
+    switch (code)
+    {
+        case RC_UVARI:
+        case RC_ORIGIN:
+            if (!ValueAppend(1))
+                return false;
+            return ValueAppend(UvariLength((byte)m_value.data[m_value.size - 1]) - 1);
+
+        case RC_IDENT:
+        case RC_UNITS:
+            if (!ValueAppend(1))
+                return false;
+            return ValueAppend((byte)m_value.data[m_value.size - 1]);
+
+        case RC_ASCII:
+            {
+                size_t  pos, var_len;
+                UINT    len = 0;
+
+                pos = m_value.size;
+                if (!ValueReadRaw(RC_UVARI))
+                    return false;
+
+                // длина строки - UVARI в big endian, без старших битов размера
+                var_len = m_value.size - pos;
+                for (size_t i = 0; i < var_len; i++)
+                    len = (len << 8) | (byte)m_value.data[pos + i];
+                len &= var_len == 4 ? 0x3FFFFFFF : (var_len == 2 ? 0x7FFF : 0x7F);
+
+                return ValueAppend(len);
+            }
+
+        case RC_OBNAME:
+            return ValueReadRaw(RC_ORIGIN) && ValueAppend(1) && ValueReadRaw(RC_IDENT);
+
+        case RC_OBJREF:
+            return ValueReadRaw(RC_IDENT) && ValueReadRaw(RC_OBNAME);
+
+        case RC_ATTREF:
+            return ValueReadRaw(RC_IDENT) && ValueReadRaw(RC_OBNAME) && ValueReadRaw(RC_IDENT);
+
+        default:
+            break;
+    }
+
+    if (code < RC_FSHORT || code > RC_LAST || s_rep_codes_length[code - 1].length <= 0)
+        return false;
+
+    return ValueAppend(s_rep_codes_length[code - 1].length);
+}
+
+/*
+*  строка хранилища из собранного в m_value кадра переменной длины, только выбранные каналы
+*/
+bool CDLISParser::FrameRowAddVariable(CDLISFrame *target, FrameData *frame, int number)
+{
+    char   *row;
+    int     len = 0;
+
+    m_row_offsets.resize(frame->selected_count);
+
+    for (int j = 0; j < frame->selected_count; j++)
+    {
+        int i = frame->selected_index ? frame->selected_index[j] : j;
+
+        m_row_offsets[j] = len;
+        len += m_channel_offsets[i + 1] - m_channel_offsets[i];
+    }
+
+    row = target->AddRowVariable(number, len, &m_row_offsets[0]);
+    if (!row)
+        return false;
+
+    for (int j = 0; j < frame->selected_count; j++)
+    {
+        int i = frame->selected_index ? frame->selected_index[j] : j;
+
+        memcpy(row + m_row_offsets[j], m_value.data + m_channel_offsets[i], m_channel_offsets[i + 1] - m_channel_offsets[i]);
+    }
+
+    return true;
+}
+
+/*
+*  строка хранилища из кадра raw: копируются только участки выбранных каналов
+*/
+bool CDLISParser::FrameRowAdd(CDLISFrame *target, FrameData *frame, int number, const char *raw)
+{
+    char *row;
+
+    row = target->AddRow(number);
+    if (!row)
+        return false;
 
+    for (int i = 0; i < frame->range_count; i++)
+        memcpy(row + frame->ranges[i].dst, raw + frame->ranges[i].src, frame->ranges[i].len);
 
+    return true;
+}
+
+
+void CDLISParser::FrameDataAdd(FrameData *frame_data)
+{
     FrameData **frame_tail;
 
     frame_tail = &m_frame_data;
@@ -1348,54 +2851,180 @@ CDLISParser::FrameData *CDLISParser::FrameDataBuild(DlisValueObjName *obj_name)
         frame_tail = &(*frame_tail)->next;
     }
     *frame_tail = frame_data;
-
-    return frame_data; 
 }
 
 
 bool CDLISParser::FrameDataParse(FrameData *frame)
 {
-    static char buf[8 * Kb];
-
-    void     *dst;
+    char     *row;
     size_t    len          = 0;
     int       number_frame = 0;
+    int       first_frame  = -1;
 
-    m_frame.Initialize();
-    m_frame.AddChannels(&frame->obj_key, frame->channels, frame->channel_count, frame->len);
+    CDLISFrame *target = &m_frame;
+
+    // выборочное чтение: кадры, подходящие под запрос, добавляются к его результату
+    if (m_frame_request.frame)
+    {
+        target = m_frame_request.frame;
+    }
+    else
+    {
+        // накопленные кадры другого фрейма отдаем до начала нового пакета
+        if (m_batch_data && m_batch_data != frame)
+            FrameBatchFlush();
+
+        if (!m_batch_data)
+        {
+            m_frame.Initialize();
+            m_frame.AddChannels(&frame->obj_key, frame->selected, frame->selected_count, frame->selected_len, frame->variable);
+            m_batch_data = frame;
+        }
+    }
 
     do
     {
         // читаем номер фрейма
-        if (!ReadCodeSimple(RC_UVARI, &dst, &len))
-            return false;
-        memcpy(&number_frame, dst, len);
-        // читаем данные фрейма
-        if (!ReadRawData(buf, frame->len))
-            return false;
-        // добавляем в хранилище данных текущего фрейма
-        if (!m_frame.AddRawData(number_frame, buf, frame->len))
+        UINT number;
+
+        if (!ReadUvari(&number, &len))
             return false;
+        number_frame = (int)number;
+        if (first_frame < 0)
+            first_frame = number_frame;
+        // кадр с каналами переменной длины: разбираем последовательно по значениям
+        if (frame->variable)
+        {
+            if (!FrameReadVariable(frame))
+                return false;
+
+            if (!frame->selected_count || !FrameRequestMatch(frame, number_frame, m_value.data))
+                continue;
+
+            if (!FrameRowAddVariable(target, frame, number_frame))
+                return false;
+        }
+        // кадр целиком в сегменте: копируем прямо из памяти сегмента в хранилище кадров
+        else if (m_segment.len >= (size_t)frame->len)
+        {
+            char *raw = m_segment.current;
+
+            m_segment.current += frame->len;
+            m_segment.len     -= frame->len;
+
+            // кадры вне запроса выборочного чтения и кадры без выбранных каналов пропускаем
+            if (!frame->selected_count || !FrameRequestMatch(frame, number_frame, raw))
+                continue;
+
+            if (!FrameRowAdd(target, frame, number_frame, raw))
+                return false;
+        }
+        // кадр на границе сегментов при проекции: собираем его целиком во временном буфере
+        else if (frame->selected_len != frame->len)
+        {
+            if (!m_value.Resize(frame->len))
+                return false;
+
+            if (!ReadRawData(m_value.data, frame->len))
+                return false;
+
+            if (!frame->selected_count || !FrameRequestMatch(frame, number_frame, m_value.data))
+                continue;
+
+            if (!FrameRowAdd(target, frame, number_frame, m_value.data))
+                return false;
+        }
+        // кадр на границе сегментов: части собираем сразу в строку хранилища
+        else
+        {
+            row = target->AddRow(number_frame);
+            if (!row)
+                return false;
+
+            if (!ReadRawData(row, frame->len))
+                return false;
+
+            if (!FrameRequestMatch(frame, number_frame, row))
+                target->RemoveRow();
+        }
     }
     // вычитываем данные, до тех пор пока они есть, и текущий сегмент не послдений
     while (m_segment.len || !SegmentLast(&m_segment_header));
 
-    // вызываем нотифай функцию если она задана
-    if (m_notify_frame_func)
-        m_notify_frame_func(&m_frame, m_notify_params);
+    if (m_index_build)
+        m_index.RecordFrame(frame->index, first_frame, number_frame);
+
+    // вызываем нотифай функцию, когда пакет набран (без пакетной выдачи - на каждую IFLR);
+    // курсор проверяет размер пакета сам, после разбора сегмента
+    if (!m_frame_request.frame && !m_cursor && FrameBatchFull())
+        FrameBatchFlush();
 
     return true;
 }
 
 
-CDLISParser::FrameData *CDLISParser::FrameDataFind(DlisValueObjName *obj_name)
+bool CDLISParser::FrameBatchFull()
+{
+    // у курсора размер пакета задается в каждом ParseNext, только в кадрах
+    int     frames = m_cursor ? m_cursor_batch : m_batch_frames;
+    size_t  bytes  = m_cursor ? 0 : m_batch_bytes;
+
+    if (frames == 0 && bytes == 0)
+        return true;
+
+    if (frames && m_frame.CountRows() >= frames)
+        return true;
+
+    if (bytes && m_frame.CountBytes() >= bytes)
+        return true;
+
+    return false;
+}
+
+/*
+*  отдаем накопленные кадры, следующая IFLR начнет новый пакет
+*/
+void CDLISParser::FrameBatchFlush()
+{
+    FrameData *frame = m_batch_data;
+
+    m_batch_data = NULL;
+
+    if (!frame || !frame->selected_count)
+        return;
+
+    // курсор: пакет забирает вызывающий, m_frame освобождается под следующий
+    if (m_cursor)
+    {
+        m_frame.Swap(&m_frame_ready);
+        m_cursor_ready = true;
+        return;
+    }
+
+    // конвейер: пакет уходит в поток преобразования, m_frame получает свободный
+    if (m_pipeline.IsStarted())
+    {
+        m_pipeline.Submit(&m_frame);
+        return;
+    }
+
+    if (m_notify_frame_func)
+        m_notify_frame_func(&m_frame, m_notify_params);
+}
+
+
+/*
+*  root - логический файл фрейма, NULL - любой
+*/
+CDLISParser::FrameData *CDLISParser::FrameDataFind(DlisValueObjName *obj_name, DlisSet *root)
 {
     FrameData *next, *r = NULL;
 
+    // имена фреймов уникальны только внутри логического файла
     next = m_frame_data;
     while (next)
     {
-        if (ObjectNameCompare(&next->obj_key, obj_name))
+        if ((!root || next->root == root) && ObjectNameCompare(&next->obj_key, obj_name))
         {
             r = next;
             break;
@@ -1429,7 +3058,8 @@ bool CDLISParser::ReadSet()
 
     if (m_component_header.format & TypeSet::TypeSetType)
     {
-        ReadCodeSimple(RC_IDENT, (void **)&val, &len);
+        if (!ReadString(RC_IDENT, &val, &len))
+            return false;
         
         set->type = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
         if (!set->type)
@@ -1440,7 +3070,8 @@ bool CDLISParser::ReadSet()
 
     if (m_component_header.format & TypeSet::TypeSetName)
     {
-        ReadCodeSimple(RC_IDENT, (void **)&val, &len);
+        if (!ReadString(RC_IDENT, &val, &len))
+            return false;
 
         set->name = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
         if (!set->name)
@@ -1511,21 +3142,28 @@ bool CDLISParser::ReadAttribute()
     // последовательно читаем свойства атрибута
     if (m_component_header.format & TypeAttribute::TypeAttrLable)
     {
-        ReadCodeSimple(RC_IDENT, (void **)&val, &len);
+        if (!ReadString(RC_IDENT, &val, &len))
+            return false;
         attr->label = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
         strcpy_s(attr->label, len + 1, val);
     }
 
     if (m_component_header.format & TypeAttribute::TypeAttrCount)
     {
-        ReadCodeSimple(RC_UVARI, (void **)&val, &len);
-        memcpy(&attr->count, val, len);
+        UINT count;
+
+        if (!ReadUvari(&count, &len))
+            return false;
+        attr->count = count;
     }
 
     if (m_component_header.format & TypeAttribute::TypeAttrRepresentationCode)
     {
-        ReadCodeSimple(RC_USHORT, (void **)&val, &len);
-        memcpy(&attr->code, val, len);
+        unsigned char code;
+
+        if (!ReadCode<RC_USHORT>(&code))
+            return false;
+        attr->code = (RepresentationCodes)code;
     }
     else
     {
@@ -1547,7 +3185,8 @@ bool CDLISParser::ReadAttribute()
     
     if (m_component_header.format & TypeAttribute::TypeAttrUnits)
     {
-        ReadCodeSimple(RC_IDENT, (void **)&val, &len);
+        if (!ReadString(RC_IDENT, &val, &len))
+            return false;
 
         attr->units = m_allocator.MemoryGet(m_pull_id_strings, len + 1);
         strcpy_s(attr->units, len + 1, val);
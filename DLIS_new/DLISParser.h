@@ -6,15 +6,21 @@
 
 #include    <vector>
 #include    <string>
+#include    <mutex>
 
 #include    "DlisCommon.h"
+#include    "DlisRepCodes.h"
+#include    "DlisSwap.h"
 #include    "DlisAllocator.h"
 #include    "MemoryBuffer.h"
 #include    "DLISFrame.h"
+#include    "DlisReadAhead.h"
+#include    "DlisSource.h"
+#include    "DlisRecordMap.h"
+#include    "DlisIndex.h"
+#include    "DlisPipeline.h"
 
 
-typedef void (*DlisNotifyCallback)(CDLISFrame *frame, void *params);
-
 class CDLISParser
 {
 private:
@@ -23,6 +29,11 @@ private:
         Kb         = 1024,
         Mb         = Kb * Kb,
         FILE_CHUNK = 16 * Mb,
+        MAP_PREFETCH = 32 * Mb,
+        INDEX_PROBE  = 1 * Kb,
+        PIPELINE_READ_AHEAD = 4,
+        //     :    visible record
+        READ_AHEAD_HEAD     = 64 * Kb,
 
         MAX_ATTRIBUTE_LABEL       = 64,
         MAX_TEMPLATE_ATTRIBUTES   = 32,
@@ -51,8 +62,14 @@ private:
     };
 
     typedef unsigned char byte;
-    //    
-    HANDLE              m_file;
+    //    DLIS
+    CDLISSource        *m_source;
+    //   DLIS,     
+    CDLISFileSource     m_file_source;
+    //   DLIS   
+    CDLISMemorySource   m_memory_source;
+    //       
+    bool                m_map_mode;
     //  DLIS
     StorageUnitLabel    m_storage_unit_label;
 
@@ -62,10 +79,24 @@ private:
         size_t      pos;
         size_t      remaind;
         size_t      size_chunk;
+        //    , (UINT64)-1 -  ,    
         UINT64      file_remaind;
+        //    ,   
+        bool        mapped;
+        // ,      
+        size_t      advise_pos;
+        //    (data[0])  ;   2^64 -   
+        //    ,      begin
+        UINT64      base;
+        size_t      begin;
     };
     //      
     FileChunk        m_file_chunk;
+    //     
+    size_t           m_chunk_size;
+    //      ( 0 - )
+    CDLISReadAhead   m_read_ahead;
+    int              m_read_ahead_depth;
 
     //  DLIS visible record
     struct VisibleRecord
@@ -73,6 +104,8 @@ private:
         char      *current;
         char      *end; 
         size_t     len;
+        //   visible record  
+        UINT64     offset;
     };
 
     //  DLIS  
@@ -83,20 +116,58 @@ private:
         size_t           len;
     };
 
+    //  ,     (   )
+    struct FrameRange
+    {
+        size_t            src;
+        size_t            dst;
+        size_t            len;
+    };
+
     struct FrameData
     {
         DlisValueObjName  obj_key;
         DlisChannelInfo  *channels;
         int               channel_count; 
         int               len;
+        //    : len      ,
+        //      
+        bool              variable;
+        //     :   (   ),
+        //      ;   -    
+        DlisChannelInfo  *selected;
+        int              *selected_index;       //     channels
+        int               selected_count;
+        int               selected_len;
+        FrameRange       *ranges;
+        int               range_count;
+        //  ,    
+        DlisSet          *root;
+        //     
+        int               index;
         // 
         FrameData        *next;
     };
 
+    //      data  frame:
+    //   [first, last)      [index_from, index_to]
+    struct FrameRequest
+    {
+        FrameData        *data;
+        CDLISFrame       *frame;
+        int               first;
+        int               last;
+        bool              by_index;
+        double            index_from;
+        double            index_to;
+    };
+
     // dlis ,   
     VisibleRecord      m_visible_record;
     //  , 
     SegmentRecord      m_segment;
+    //  ,   representation code (,  )
+    MemoryBuffer       m_value;
     SegmentHeader      m_segment_header;
     ComponentHeader    m_component_header;
 
@@ -129,6 +200,52 @@ private:
     size_t             m_pull_id_frame_data;
     
     CDLISFrame         m_frame;
+    FrameRequest       m_frame_request;
+    //  visible record,    
+    CDLISRecordMap     m_record_map;
+    //    (sidecar ),    Open
+    CDLISIndex         m_index;
+    bool               m_index_build;
+    std::wstring       m_index_dir;
+
+    // : ,    ( -  )
+    struct ChannelKey
+    {
+        std::string       identifier;
+        bool              by_name;              //   ,  origin  copy
+        UINT              origin_reference;
+        UINT              copy_number;
+    };
+    std::vector<ChannelKey> m_projection;
+    //        m_value (   )
+    std::vector<int>        m_channel_offsets;
+    std::vector<int>        m_row_offsets;
+
+    //   :      m_frame  batch_frames 
+    //  batch_bytes  (0 -  ), m_batch_data -   
+    int                 m_batch_frames;
+    size_t              m_batch_bytes;
+    FrameData          *m_batch_data;
+    //    ():     m_frame_ready   callback,
+    //         SetBatch
+    bool                m_cursor;
+    bool                m_cursor_ready;
+    int                 m_cursor_batch;
+    CDLISFrame          m_frame_ready;
+    // :  (),        
+    CDLISPipeline       m_pipeline;
+    int                 m_pipeline_depth;
+    int                 m_pipeline_threads;
+    //    :     (, , ),
+    //       m_sets   
+    int                         m_file_threads;
+    std::vector<CDLISParser *>  m_parts;
+    std::mutex                  m_notify_lock;
+    //   : ,       ( ,
+    //     )
+    CDLISParser                *m_part_owner;
+    size_t                      m_part_index;
+    std::atomic<bool>           m_part_done;
 
     DlisNotifyCallback  m_notify_frame_func;
     void               *m_notify_params;
@@ -142,13 +259,63 @@ public:
 
     //  DLIS
     bool            Parse(const wchar_t *file_name);
+    //     (       )
+    bool            Parse(CDLISSource *source);
+    //   DLIS   ,   (    Shutdown)
+    bool            Parse(const void *data, size_t len);
+    //   [begin, end) ,   FHLR (  )
+    bool            ParseRange(CDLISSource *source, UINT64 begin, UINT64 end);
+    //    :   EFLR,     
+    bool            Open(const wchar_t *file_name);
+    //    [first, last)  frame_obj,    IFLR   ( Open)
+    // frame_obj -    FRAME  
+    bool            ReadFrames(DlisObject *frame_obj, int first, int last, CDLISFrame *frame);
+    // ,   ()     [from, to],   
+    bool            ReadFramesByIndex(DlisObject *frame_obj, double from, double to, CDLISFrame *frame);
+    //   : ParseBegin  ,  ParseNext   
+    //     batch  (0 -   IFLR)     .
+    //    IFLR ,       batch    IFLR.
+    //     ParseNext, NULL -    
+    bool            ParseBegin(const wchar_t *file_name);
+    bool            ParseBegin(CDLISSource *source);
+    CDLISFrame     *ParseNext(int batch, bool *error);
+    //      (  )
+    void            ParseEnd();
+    //    visible record   
+    bool            ScanRecords(const wchar_t *file_name);
     // ,       
     bool            Initialize();
     void            Shutdown();
 
     DlisSet        *GetRoot()     { return m_sets; }
+    CDLISRecordMap *GetRecordMap(){ return &m_record_map; }
 
     void            CallbackNotifyFrame(DlisNotifyCallback func, void *params);
+    //  :   callback  frames   bytes    
+    // (frames <= 1  bytes == 0 -    IFLR).    IFLR 
+    //    frames  bytes    IFLR
+    void            SetBatch(int frames, size_t bytes);
+    //   Parse:      callback   
+    // (  ), depth -      (0 - ), threads - 
+    // : IFLR       
+    void            SetPipeline(int depth, int threads = 1);
+    // Parse(file_name):   ( FHLR   FHLR)   threads ,
+    // callback   ,       :
+    //     . IFLR     
+    //     
+    void            SetFileThreads(int threads);
+    //      ,    
+    void            SetMapMode(bool map_mode);
+    //  : depth   chunk_size  (0 -   )
+    void            SetReadAhead(int depth, size_t chunk_size);
+    //        (  )
+    void            SetCacheMode(CDLISFileSource::CacheMode mode);
+    //     (NULL -      DLIS)
+    void            SetIndexDir(const wchar_t *dir);
+    // :      ,     
+    //    (count == 0 -  ).       origin  copy
+    void            SetChannels(const char **names, int count);
+    void            SetChannels(const DlisValueObjName *names, int count);
 
     char           *AttrGetString(DlisAttribute *attr, char *buf, size_t buf_len);
     int             AttrGetInt(DlisAttribute *attr);
@@ -165,8 +332,10 @@ private:
     //   
     bool            FileOpen(const wchar_t *file_name);
     bool            FileClose();
-    bool            FileRead(char *data, DWORD len);
-    UINT64          FileSize();
+    bool            FileRead(char *data, size_t len, size_t *readed);
+    bool            FileMap();
+    void            FileUnmap();
+    void            FileAdvise(size_t pos, size_t len);
     //  bit 2 littel endian
     inline void     Big2LittelEndian(void *dst, size_t len);
     void            Big2LittelEndianByte(byte *byte);
@@ -174,10 +343,26 @@ private:
     //     
     bool            ReadStorageUnitLabel();
     bool            ReadLogicalFiles();
+    bool            ReadLogicalRecord(const CDLISIndex::Record *record);
+    bool            ReadIndexed();
+    //      ,  -   visible record
+    bool            ParseParallel(const wchar_t *file_name);
+    bool            ParseRange(const wchar_t *file_name, UINT64 begin, UINT64 end);
+    void            PartsFree();
+    static void     NotifyPart(CDLISFrame *frame, void *params);
+    void            IndexName(const wchar_t *file_name, std::wstring *index_name);
+    int             LogicalFileIndex(const DlisSet *root);
+    bool            SourceReadAt(UINT64 offset, char *data, size_t len, size_t *readed);
+    DlisSet        *LogicalFileFind(const DlisSet *set);
 
     //   
     bool            BufferNext(char **data, size_t len);
-    bool            BufferInitialize();
+    bool            BufferFill(size_t len);
+    bool            BufferSwap(size_t len);
+    bool            BufferInitialize(bool read_ahead = true);
+    bool            BufferReadAhead();
+    bool            BufferSeek(UINT64 offset);
+    void            BufferFree();
     bool            BufferIsEOF();
     bool            VisibleRecordNext();
 
@@ -195,6 +380,10 @@ private:
     //    DLIS
     bool            ReadRawData(void *dst, size_t len);
     bool            ReadCodeSimple(RepresentationCodes code, void **dst, size_t *len);
+    template <RepresentationCodes code>
+    bool            ReadCode(typename DlisRepCode<code>::type *value);
+    bool            ReadUvari(UINT *value, size_t *len);
+    bool            ReadString(RepresentationCodes code, char **str, size_t *len);
     bool            ReadCodeComplex(RepresentationCodes code, void *dst);
 
     bool            ReadIndirectlyFormattedLogicalRecord();
@@ -214,6 +403,52 @@ private:
     char           *StringTrim(char *str, size_t *len);
 
     FrameData      *FrameDataBuild(DlisValueObjName *obj_name);
+    FrameData      *FrameDataLink(FrameData *src);
+    FrameData      *FrameDataFindPrevious(DlisValueObjName *obj_name);
+    bool            FrameDataProject(FrameData *frame_data);
+    bool            ChannelSelected(const DlisChannelInfo *channel);
+    bool            FrameRowAdd(CDLISFrame *target, FrameData *frame, int number, const char *raw);
+    bool            FrameReadVariable(FrameData *frame);
+    bool            FrameRowAddVariable(CDLISFrame *target, FrameData *frame, int number);
+    bool            ValueReadRaw(RepresentationCodes code);
+    bool            ValueAppend(size_t len);
+    void            FrameDataAdd(FrameData *frame_data);
     bool            FrameDataParse(FrameData *frame);
-    FrameData      *FrameDataFind(DlisValueObjName *obj_name);
+    bool            FrameBatchFull();
+    void            FrameBatchFlush();
+    FrameData      *FrameDataFind(DlisValueObjName *obj_name, DlisSet *root);
+
+    //   
+    bool            FrameRequestRead(DlisObject *frame_obj, CDLISFrame *frame);
+    bool            FrameRequestMatch(FrameData *frame, int number, const char *raw);
+    void            IndexSearch(DlisChannelInfo *channel, const CDLISIndex::Record **records, size_t count, size_t *begin, size_t *end);
+    bool            RecordIndexValue(const CDLISIndex::Record *record, DlisChannelInfo *channel, double *value);
+    bool            ChannelValue(DlisChannelInfo *channel, const char *raw, double *value);
+    static size_t   UvariLength(byte first);
 };
+
+/*
+*     :       
+*/
+template <RepresentationCodes code>
+inline bool CDLISParser::ReadCode(typename DlisRepCode<code>::type *value)
+{
+    typedef DlisRepCode<code> traits;
+
+    static_assert(sizeof(typename traits::type) == traits::size, "representation code size mismatch");
+
+    //    :  ,     
+    if (m_segment.len >= traits::size)
+    {
+        memcpy(value, m_segment.current, traits::size);
+        m_segment.current += traits::size;
+        m_segment.len     -= traits::size;
+    }
+    else if (!ReadRawData(value, traits::size))
+        return false;
+
+    if (traits::swap)
+        CDLISSwapValue<traits::size>::Swap(value);
+
+    return true;
+}
@@ -0,0 +1,449 @@
+#include "StdAfx.h"
+#include "DlisBatch.h"
+#include "DlisFile.h"
+#if defined(_MSC_VER)
+#include "new.h"
+#endif
+
+#include <algorithm>
+
+
+CDLISBatch::CDLISBatch() : m_workers(NULL), m_count(0), m_outstanding(0), m_memory(0), m_budget(DEFAULT_BUDGET),
+    m_notify_func(NULL), m_notify_params(NULL)
+{
+}
+
+
+CDLISBatch::~CDLISBatch()
+{
+    Free();
+}
+
+
+bool CDLISBatch::AddFile(const wchar_t *file_name)
+{
+    CDLISFile  dlis_file;
+    File      *file;
+
+    if (!file_name)
+        return false;
+
+    if (!dlis_file.Open(file_name, CDLISFile::FILE_READ))
+        return false;
+
+    file = new(std::nothrow) File();
+    if (!file)
+        return false;
+
+    file->name      = file_name;
+    file->size      = dlis_file.Size();
+    file->index     = (int)m_files.size();
+    file->result    = false;
+    file->parser    = NULL;
+    file->batch     = this;
+    file->worker    = NULL;
+    file->submitted = 0;
+    file->delivered = 0;
+    file->pending   = 0;
+
+    m_files.push_back(file);
+    return true;
+}
+
+
+int CDLISBatch::AddDirectory(const wchar_t *dir)
+{
+    WIN32_FIND_DATAW  data;
+    HANDLE            find;
+    std::wstring      path;
+    int               count = 0;
+
+    if (!dir)
+        return 0;
+
+    path = dir;
+    if (!path.empty() && path[path.size() - 1] != L'\\' && path[path.size() - 1] != L'/')
+        path += L'\\';
+
+    find = FindFirstFileW((path + L"*.dlis").c_str(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+        return 0;
+
+    do
+    {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+
+        if (AddFile((path + data.cFileName).c_str()))
+            count++;
+    }
+    while (FindNextFileW(find, &data));
+
+    FindClose(find);
+    return count;
+}
+
+
+void CDLISBatch::SetMemoryBudget(size_t bytes)
+{
+    m_budget = bytes ? bytes : DEFAULT_BUDGET;
+}
+
+
+void CDLISBatch::Free()
+{
+    for (size_t i = 0; i < m_files.size(); i++)
+        delete m_files[i];
+
+    m_files.clear();
+}
+
+
+int CDLISBatch::CountFiles()
+{
+    return (int)m_files.size();
+}
+
+
+const wchar_t *CDLISBatch::GetFileName(int file)
+{
+    if (file < 0 || file >= (int)m_files.size())
+        return NULL;
+
+    return m_files[file]->name.c_str();
+}
+
+
+bool CDLISBatch::GetResult(int file)
+{
+    if (file < 0 || file >= (int)m_files.size())
+        return false;
+
+    return m_files[file]->result;
+}
+
+/*
+*  файлы раздаются потокам по кругу от меньшего к большему: поток берет свои задачи
+*  с конца очереди, поэтому первыми начинаются самые большие файлы
+*/
+bool CDLISBatch::Run(int threads, DlisBatchCallback func, void *params)
+{
+    std::vector<File *>  order;
+    bool                 r = true;
+
+    if (m_files.empty())
+        return true;
+
+    if (threads <= 0)
+        threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0)
+        threads = 1;
+
+    m_workers = new(std::nothrow) Worker[threads];
+    if (!m_workers)
+        return false;
+
+    m_count         = threads;
+    m_outstanding   = 0;
+    m_memory        = 0;
+    m_notify_func   = func;
+    m_notify_params = params;
+
+    order = m_files;
+    std::sort(order.begin(), order.end(), [](const File *left, const File *right) { return left->size < right->size; });
+
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        Task task = { TASK_FILE, order[i], NULL, 0 };
+
+        order[i]->result    = false;
+        order[i]->submitted = 0;
+        order[i]->delivered = 0;
+        order[i]->pending   = 1;
+
+        TaskPush(&m_workers[i % threads], task);
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        m_workers[i].index  = i;
+        m_workers[i].thread = std::thread(&CDLISBatch::ThreadProc, this, &m_workers[i]);
+    }
+
+    for (int i = 0; i < threads; i++)
+        m_workers[i].thread.join();
+
+    delete [] m_workers;
+    m_workers = NULL;
+    m_count   = 0;
+
+    for (size_t i = 0; i < m_files.size(); i++)
+        if (!m_files[i]->result)
+            r = false;
+
+    return r;
+}
+
+
+void CDLISBatch::ThreadProc(Worker *worker)
+{
+    Task task;
+
+    for (int spin = 0; ; spin++)
+    {
+        if (TaskGet(worker, &task))
+        {
+            TaskRun(worker, &task);
+            spin = 0;
+            continue;
+        }
+
+        // задач нет ни в одной очереди и ни одна не выполняется - новых не появится
+        if (m_outstanding.load() == 0)
+            break;
+
+        CDLISQueue<Task>::Wait(spin);
+    }
+}
+
+/*
+*  своя задача - с конца очереди (последняя добавленная), чужая - с начала (самая старая)
+*/
+bool CDLISBatch::TaskGet(Worker *worker, Task *task)
+{
+    {
+        std::lock_guard<std::mutex> guard(worker->lock);
+
+        if (!worker->tasks.empty())
+        {
+            *task = worker->tasks.back();
+            worker->tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (int i = 1; i < m_count; i++)
+    {
+        Worker *victim = &m_workers[(worker->index + i) % m_count];
+
+        std::lock_guard<std::mutex> guard(victim->lock);
+
+        if (!victim->tasks.empty())
+        {
+            *task = victim->tasks.front();
+            victim->tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+*  только преобразование пакета из своей очереди: пока поток ждет очереди на callback,
+*  он не должен начинать разбор другого файла
+*/
+bool CDLISBatch::TaskGetDecode(Worker *worker, Task *task)
+{
+    std::lock_guard<std::mutex> guard(worker->lock);
+
+    if (worker->tasks.empty() || worker->tasks.back().type != TASK_DECODE)
+        return false;
+
+    *task = worker->tasks.back();
+    worker->tasks.pop_back();
+    return true;
+}
+
+
+void CDLISBatch::TaskPush(Worker *worker, const Task &task)
+{
+    m_outstanding++;
+
+    std::lock_guard<std::mutex> guard(worker->lock);
+    worker->tasks.push_back(task);
+}
+
+
+void CDLISBatch::TaskRun(Worker *worker, Task *task)
+{
+    if (task->type == TASK_FILE)
+    {
+        FileParse(worker, task->file);
+    }
+    else
+    {
+        task->frame->Decode();
+        FrameDeliver(task->file, task->frame, task->number);
+        FileRelease(task->file);
+    }
+
+    m_outstanding--;
+}
+
+/*
+*  разбор файла целиком: набранные пакеты кадров уходят задачами в очередь этого потока.
+*  Буфер чтения тоже из бюджета: пока его нет, помогаем с пакетами из своей очереди
+*  и ждем, когда другие файлы освободят память
+*/
+void CDLISBatch::FileParse(Worker *worker, File *file)
+{
+    Task task;
+
+    for (int spin = 0; !MemoryReserve(FILE_CHUNK); spin++)
+    {
+        if (TaskGetDecode(worker, &task))
+        {
+            TaskRun(worker, &task);
+            spin = 0;
+        }
+        else
+            CDLISQueue<Task>::Wait(spin);
+    }
+
+    file->parser = new(std::nothrow) CDLISParser();
+
+    if (file->parser && file->parser->Initialize())
+    {
+        file->worker = worker;
+        file->parser->CallbackNotifyFrame(NotifyFrame, file);
+        file->parser->SetBatch(0, BATCH_BYTES);
+        file->parser->SetReadAhead(0, FILE_CHUNK);
+
+        file->result = file->parser->Parse(file->name.c_str());
+    }
+
+    // буфер чтения освобождается вместе с парсером
+    if (!file->parser)
+        m_memory -= FILE_CHUNK;
+
+    FileRelease(file);
+}
+
+/*
+*  парсер нужен, пока не преобразованы все пакеты: описания каналов кадров принадлежат ему
+*/
+void CDLISBatch::FileRelease(File *file)
+{
+    if (--file->pending > 0)
+        return;
+
+    if (file->parser)
+    {
+        file->parser->Shutdown();
+        delete file->parser;
+        file->parser = NULL;
+
+        m_memory -= FILE_CHUNK;
+    }
+}
+
+
+void CDLISBatch::NotifyFrame(CDLISFrame *frame, void *params)
+{
+    File *file = (File *)params;
+
+    file->batch->FrameSubmit(file, frame);
+}
+
+/*
+*  пакет передается задаче без копирования (обмен буферами с новым кадром).
+*  Бюджет памяти исчерпан - пакет преобразуется здесь же, но callback для него
+*  можно вызвать только после всех предыдущих пакетов файла
+*/
+void CDLISBatch::FrameSubmit(File *file, CDLISFrame *frame)
+{
+    CDLISFrame *out = NULL;
+    size_t      bytes = frame->CountBytes();
+    UINT64      number = file->submitted++;
+
+    if (MemoryReserve(bytes))
+    {
+        out = new(std::nothrow) CDLISFrame();
+        if (!out)
+            m_memory -= bytes;
+    }
+
+    if (out)
+    {
+        Task task = { TASK_DECODE, file, out, number };
+
+        frame->Swap(out);
+        file->pending++;
+
+        TaskPush(file->worker, task);
+        return;
+    }
+
+    frame->Decode();
+
+    for (int spin = 0; ; spin++)
+    {
+        Task task;
+
+        {
+            std::lock_guard<std::mutex> guard(file->lock);
+
+            if (file->delivered == number)
+            {
+                if (m_notify_func)
+                    m_notify_func(file->index, frame, m_notify_params);
+                file->delivered++;
+                return;
+            }
+        }
+
+        // пока ждем, помогаем с пакетами из своей очереди
+        if (TaskGetDecode(file->worker, &task))
+        {
+            TaskRun(file->worker, &task);
+            spin = 0;
+        }
+        else
+            CDLISQueue<Task>::Wait(spin);
+    }
+}
+
+/*
+*  проверка бюджета и резервирование одной операцией: иначе потоки, проверившие бюджет
+*  одновременно, вместе его превысят. Когда ничего не зарезервировано, резерв проходит всегда:
+*  иначе буфер чтения больше бюджета не получил бы ни один файл
+*/
+bool CDLISBatch::MemoryReserve(size_t bytes)
+{
+    size_t used = m_memory.load();
+
+    do
+    {
+        if (used != 0 && used + bytes > m_budget)
+            return false;
+    }
+    while (!m_memory.compare_exchange_weak(used, used + bytes));
+
+    return true;
+}
+
+/*
+*  преобразованный пакет ждет предыдущие, callback вызывается строго по порядку пакетов файла
+*/
+void CDLISBatch::FrameDeliver(File *file, CDLISFrame *frame, UINT64 number)
+{
+    std::lock_guard<std::mutex> guard(file->lock);
+
+    file->ready[number] = frame;
+
+    while (!file->ready.empty() && file->ready.begin()->first == file->delivered)
+    {
+        CDLISFrame *next = file->ready.begin()->second;
+
+        file->ready.erase(file->ready.begin());
+
+        if (m_notify_func)
+            m_notify_func(file->index, next, m_notify_params);
+        file->delivered++;
+
+        m_memory -= next->CountBytes();
+        next->Shutdown();
+        delete next;
+    }
+}
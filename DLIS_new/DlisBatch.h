@@ -0,0 +1,124 @@
+#pragma once
+
+#include "DLISParser.h"
+#include "DlisQueue.h"
+
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// кадры файла file (номер в списке пакета) в порядке файла; для разных файлов callback
+// вызывается параллельно из разных потоков
+typedef void (*DlisBatchCallback)(int file, CDLISFrame *frame, void *params);
+
+// пакетный разбор множества файлов DLIS в пуле потоков с перехватом работы (work stealing):
+// задачи - разбор файла целиком и преобразование пакета его кадров. Пока большой файл
+// разбирается одним потоком, его пакеты кадров забирают простаивающие потоки, поэтому
+// несколько больших файлов не оставляют остальные ядра без работы
+class CDLISBatch
+{
+public:
+    enum constants
+    {
+        Kb             = 1024,
+        Mb             = Kb * Kb,
+        DEFAULT_BUDGET = 512 * Mb,
+        BATCH_BYTES    = 1 * Mb,                // размер пакета кадров - задачи преобразования
+        FILE_CHUNK     = 4 * Mb,                // буфер чтения парсера, учитывается в бюджете
+    };
+
+private:
+    struct Worker;
+
+    struct File
+    {
+        std::wstring          name;
+        UINT64                size;
+        int                   index;
+        bool                  result;
+        CDLISParser          *parser;
+        CDLISBatch           *batch;
+        // поток, разбирающий файл (в его очередь попадают пакеты кадров)
+        Worker               *worker;
+
+        // номер следующего отдаваемого на преобразование пакета, следующего для callback
+        // и преобразованные пакеты, ждущие своей очереди
+        UINT64                submitted;
+        UINT64                delivered;
+        std::map<UINT64, CDLISFrame *> ready;
+        std::mutex            lock;
+        // задачи файла в работе: разбор и непреобразованные пакеты
+        std::atomic<int>      pending;
+    };
+
+    enum TaskType
+    {
+        TASK_FILE   = 0,                        // разбор файла
+        TASK_DECODE = 1,                        // преобразование пакета кадров
+    };
+
+    struct Task
+    {
+        TaskType              type;
+        File                 *file;
+        CDLISFrame           *frame;
+        UINT64                number;
+    };
+
+    struct Worker
+    {
+        std::deque<Task>      tasks;
+        std::mutex            lock;
+        std::thread           thread;
+        int                   index;
+    };
+
+private:
+    std::vector<File *>       m_files;
+    Worker                   *m_workers;
+    int                       m_count;
+    // задачи в очередях и в работе: ноль - пакет разобран
+    std::atomic<int>          m_outstanding;
+    // память пакетов кадров в работе и буферов чтения
+    std::atomic<size_t>       m_memory;
+    size_t                    m_budget;
+
+    DlisBatchCallback         m_notify_func;
+    void                     *m_notify_params;
+
+public:
+    CDLISBatch();
+    ~CDLISBatch();
+
+    bool            AddFile(const wchar_t *file_name);
+    // все файлы *.dlis каталога, возвращает число добавленных
+    int             AddDirectory(const wchar_t *dir);
+    // ограничение памяти пакетов кадров в работе и буферов чтения (FILE_CHUNK на разбираемый файл),
+    // 0 - DEFAULT_BUDGET. При превышении пакет преобразуется сразу в потоке разбора, а разбор
+    // следующего файла ждет освобождения памяти; бюджет меньше FILE_CHUNK - файлы разбираются по одному
+    void            SetMemoryBudget(size_t bytes);
+
+    // threads <= 0 - по числу ядер; false - хотя бы один файл не разобран
+    bool            Run(int threads, DlisBatchCallback func, void *params);
+    void            Free();
+
+    int             CountFiles();
+    const wchar_t  *GetFileName(int file);
+    bool            GetResult(int file);
+
+private:
+    void            ThreadProc(Worker *worker);
+    bool            TaskGet(Worker *worker, Task *task);
+    bool            TaskGetDecode(Worker *worker, Task *task);
+    void            TaskPush(Worker *worker, const Task &task);
+    void            TaskRun(Worker *worker, Task *task);
+
+    void            FileParse(Worker *worker, File *file);
+    void            FileRelease(File *file);
+    void            FrameSubmit(File *file, CDLISFrame *frame);
+    bool            MemoryReserve(size_t bytes);
+    void            FrameDeliver(File *file, CDLISFrame *frame, UINT64 number);
+    static void     NotifyFrame(CDLISFrame *frame, void *params);
+};
@@ -0,0 +1,257 @@
+#include "StdAfx.h"
+#include "DlisColumns.h"
+#include "DLISFrame.h"
+#include "windows.h"
+
+
+CDLISColumns::CDLISColumns() : m_count(0), m_channels_count(0)
+{
+    memset(&m_obj_key, 0, sizeof(m_obj_key));
+    memset(&m_columns, 0, sizeof(m_columns));
+    memset(&m_numbers, 0, sizeof(m_numbers));
+    memset(&m_data, 0, sizeof(m_data));
+}
+
+
+CDLISColumns::~CDLISColumns()
+{
+    Shutdown();
+}
+
+
+void CDLISColumns::Shutdown()
+{
+    m_columns.Free();
+    m_numbers.Free();
+    m_data.Free();
+
+    m_count          = 0;
+    m_channels_count = 0;
+}
+
+/*
+*  тип массива столбца по representation code канала
+*/
+CDLISColumns::ColumnType CDLISColumns::TypeOf(RepresentationCodes code)
+{
+    switch (code)
+    {
+        case RC_FSHORT:
+        case RC_FSINGL:
+        case RC_ISINGL:
+        case RC_VSINGL:
+            return COLUMN_FLOAT;
+
+        // ULONG не помещается в int без потерь
+        case RC_FDOUBL:
+        case RC_ULONG:
+            return COLUMN_DOUBLE;
+
+        case RC_SSHORT:
+        case RC_SNORM:
+        case RC_SLONG:
+        case RC_USHORT:
+        case RC_UNORM:
+        case RC_STATUS:
+            return COLUMN_INT;
+
+        default:
+            break;
+    }
+
+    return COLUMN_NONE;
+}
+
+/*
+*  сначала размечаем массивы всех столбцов в одном буфере (с выравниванием на 8 байт),
+*  затем переносим значения строк кадра по столбцам
+*/
+bool CDLISColumns::Build(CDLISFrame *frame)
+{
+    Column  *columns;
+    size_t   data_size = 0;
+    int      i, row;
+
+    m_obj_key        = *frame->GetObject();
+    m_count          = frame->CountRows();
+    m_channels_count = frame->CountColumns();
+
+    m_columns.size = 0;
+    m_numbers.size = 0;
+    m_data.size    = 0;
+
+    if (!m_columns.Resize(m_channels_count * sizeof(Column)) || !m_numbers.Resize(m_count * sizeof(int)))
+        return false;
+
+    columns = (Column *)m_columns.data;
+    for (i = 0; i < m_channels_count; i++)
+    {
+        const DlisChannelInfo *channel = frame->GetChannel(i);
+        size_t                 value_size;
+
+        columns[i].type      = TypeOf(channel->code);
+        columns[i].dimension = channel->dimension;
+        columns[i].offset    = data_size;
+
+        value_size = columns[i].type == COLUMN_DOUBLE ? sizeof(double) : sizeof(float);
+        if (columns[i].type != COLUMN_NONE)
+            data_size += ((size_t)m_count * channel->dimension * value_size + 7) & ~(size_t)7;
+    }
+
+    if (!m_data.Resize(data_size))
+        return false;
+
+    m_columns.size = m_channels_count * sizeof(Column);
+    m_numbers.size = m_count * sizeof(int);
+    m_data.size    = data_size;
+
+    for (row = 0; row < m_count; row++)
+        ((int *)m_numbers.data)[row] = frame->GetNumber(row);
+
+    for (i = 0; i < m_channels_count; i++)
+    {
+        RepresentationCodes  code = frame->GetChannel(i)->code;
+        int                  dim  = columns[i].dimension;
+        char                *dst  = m_data.data + columns[i].offset;
+
+        if (columns[i].type == COLUMN_NONE)
+            continue;
+
+        for (row = 0; row < m_count; row++)
+        {
+            const char *src;
+            int         dimension;
+
+            src = (const char *)frame->GetValueFloat(i, row, &dimension);
+            if (!src)
+                return false;
+
+            switch (code)
+            {
+                // значения уже в нужном типе - копируем строку канала целиком
+                case RC_FSHORT:
+                case RC_FSINGL:
+                case RC_ISINGL:
+                case RC_VSINGL:
+                case RC_SLONG:
+                    memcpy(dst, src, dim * sizeof(float));
+                    dst += dim * sizeof(float);
+                    break;
+
+                case RC_FDOUBL:
+                    memcpy(dst, src, dim * sizeof(double));
+                    dst += dim * sizeof(double);
+                    break;
+
+                case RC_ULONG:
+                    for (int k = 0; k < dim; k++, dst += sizeof(double))
+                        *(double *)dst = ((const unsigned int *)src)[k];
+                    break;
+
+                case RC_SNORM:
+                    for (int k = 0; k < dim; k++, dst += sizeof(int))
+                        *(int *)dst = ((const short *)src)[k];
+                    break;
+
+                case RC_UNORM:
+                    for (int k = 0; k < dim; k++, dst += sizeof(int))
+                        *(int *)dst = ((const unsigned short *)src)[k];
+                    break;
+
+                case RC_SSHORT:
+                    for (int k = 0; k < dim; k++, dst += sizeof(int))
+                        *(int *)dst = ((const signed char *)src)[k];
+                    break;
+
+                default:
+                    for (int k = 0; k < dim; k++, dst += sizeof(int))
+                        *(int *)dst = ((const unsigned char *)src)[k];
+                    break;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+int CDLISColumns::CountColumns()
+{
+    return m_channels_count;
+}
+
+
+int CDLISColumns::CountRows()
+{
+    return m_count;
+}
+
+
+DlisValueObjName *CDLISColumns::GetObject()
+{
+    return &m_obj_key;
+}
+
+
+const int *CDLISColumns::GetNumbers()
+{
+    return (const int *)m_numbers.data;
+}
+
+
+CDLISColumns::Column *CDLISColumns::ColumnGet(int column)
+{
+    if (column < 0 || column >= m_channels_count)
+        return NULL;
+
+    return (Column *)m_columns.data + column;
+}
+
+
+CDLISColumns::ColumnType CDLISColumns::GetType(int column)
+{
+    Column *col = ColumnGet(column);
+
+    return col ? col->type : COLUMN_NONE;
+}
+
+
+int CDLISColumns::GetDimension(int column)
+{
+    Column *col = ColumnGet(column);
+
+    return col ? col->dimension : 0;
+}
+
+
+const float *CDLISColumns::GetFloat(int column)
+{
+    Column *col = ColumnGet(column);
+
+    if (!col || col->type != COLUMN_FLOAT)
+        return NULL;
+
+    return (const float *)(m_data.data + col->offset);
+}
+
+
+const double *CDLISColumns::GetDouble(int column)
+{
+    Column *col = ColumnGet(column);
+
+    if (!col || col->type != COLUMN_DOUBLE)
+        return NULL;
+
+    return (const double *)(m_data.data + col->offset);
+}
+
+
+const int *CDLISColumns::GetInt(int column)
+{
+    Column *col = ColumnGet(column);
+
+    if (!col || col->type != COLUMN_INT)
+        return NULL;
+
+    return (const int *)(m_data.data + col->offset);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include   "DlisCommon.h"
+#include   "MemoryBuffer.h"
+
+class CDLISFrame;
+
+// кадры в виде столбцов: значения каждого канала лежат подряд в собственном массиве
+// в естественном типе (float, double, int). Для многомерного канала в массиве
+// подряд идут dimension значений каждой строки. Массивы строятся один раз по блоку кадров
+class CDLISColumns
+{
+public:
+    enum ColumnType
+    {
+        COLUMN_NONE   = 0,                      // код канала не числовой (строки, validated, complex)
+        COLUMN_FLOAT  = 1,                      // FSHORT, FSINGL, ISINGL, VSINGL
+        COLUMN_DOUBLE = 2,                      // FDOUBL, ULONG
+        COLUMN_INT    = 3,                      // SSHORT, SNORM, SLONG, USHORT, UNORM, STATUS
+    };
+
+private:
+    struct Column
+    {
+        ColumnType        type;
+        int               dimension;
+        size_t            offset;               // смещение массива в m_data
+    };
+
+    DlisValueObjName   m_obj_key;
+    int                m_count;
+    int                m_channels_count;
+    MemoryBuffer       m_columns;
+    MemoryBuffer       m_numbers;
+    MemoryBuffer       m_data;
+
+public:
+    CDLISColumns();
+    ~CDLISColumns();
+
+    // раскладываем все строки кадра по столбцам (строки кадра преобразуются, если еще не были)
+    bool              Build(CDLISFrame *frame);
+    void              Shutdown();
+
+    int               CountColumns();
+    int               CountRows();
+    DlisValueObjName *GetObject();
+    // номера кадров, CountRows() значений
+    const int        *GetNumbers();
+
+    ColumnType        GetType(int column);
+    int               GetDimension(int column);
+    // массив CountRows() * GetDimension(column) значений, NULL если тип столбца другой
+    const float      *GetFloat(int column);
+    const double     *GetDouble(int column);
+    const int        *GetInt(int column);
+
+    static ColumnType TypeOf(RepresentationCodes code);
+
+private:
+    Column           *ColumnGet(int column);
+};
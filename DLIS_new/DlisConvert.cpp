@@ -0,0 +1,202 @@
+#include "StdAfx.h"
+#include "DlisConvert.h"
+
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+
+
+/*
+*  IBM single: знак, 7 бит степени 16 со смещением 64, 24 бита дробной части 0.F;
+*  значение = 0.F * 16^(E - 64) = F * 2^(4 * E - 280)
+*/
+float CDLISConvert::IbmValue(unsigned int value)
+{
+    unsigned int  frac = value & 0x00FFFFFF;
+    int           exp  = (value >> 24) & 0x7F;
+    double        ret;
+
+    if (frac == 0)
+        return 0.0f;
+
+    ret = ldexp((double)frac, 4 * exp - 280);
+    return (float)(value & 0x80000000 ? -ret : ret);
+}
+
+/*
+*  VAX F: 16-битные половины слова переставлены; знак, 8 бит порядка со смещением 128,
+*  23 бита дробной части со скрытой единицей 0.1F; значение = 0.1F * 2^(E - 128)
+*/
+float CDLISConvert::VaxValue(unsigned int value)
+{
+    unsigned int  word;
+    int           exp;
+    double        ret;
+
+    word = ((value & 0x00FF00FF) << 8) | ((value >> 8) & 0x00FF00FF);
+    exp  = (word >> 23) & 0xFF;
+
+    // нулевой порядок - ноль (со знаком - зарезервированный операнд, тоже считаем нулем)
+    if (exp == 0)
+        return 0.0f;
+
+    ret = ldexp((double)((word & 0x007FFFFF) | 0x00800000), exp - 152);
+    return (float)(word & 0x80000000 ? -ret : ret);
+}
+
+/*
+*  FSHORT: 12 бит дробной части в дополнительном коде (со знаком) и 4 бита порядка;
+*  значение = M / 2^11 * 2^E
+*/
+float CDLISConvert::FshortValue(unsigned short value)
+{
+    int  mant = (short)(value & 0xFFF0) >> 4;
+    int  exp  = value & 0x000F;
+
+    return (float)ldexp((double)mant, exp - 11);
+}
+
+
+void CDLISConvert::IbmToFloat(void *data, size_t stride, size_t count)
+{
+    unsigned char *src  = (unsigned char *)data;
+    size_t         done = 0;
+
+    if (stride == sizeof(unsigned int))
+        done = IbmSSE2((unsigned int *)data, count);
+
+    src += done * stride;
+    for (size_t i = done; i < count; i++, src += stride)
+    {
+        unsigned int  v;
+        float         f;
+
+        memcpy(&v, src, sizeof(v));
+        f = IbmValue(v);
+        memcpy(src, &f, sizeof(f));
+    }
+}
+
+
+void CDLISConvert::VaxToFloat(void *data, size_t stride, size_t count)
+{
+    unsigned char *src  = (unsigned char *)data;
+    size_t         done = 0;
+
+    if (stride == sizeof(unsigned int))
+        done = VaxSSE2((unsigned int *)data, count);
+
+    src += done * stride;
+    for (size_t i = done; i < count; i++, src += stride)
+    {
+        unsigned int  v;
+        float         f;
+
+        memcpy(&v, src, sizeof(v));
+        f = VaxValue(v);
+        memcpy(src, &f, sizeof(f));
+    }
+}
+
+
+void CDLISConvert::FshortToFloat(const void *data, size_t stride, float *dst, size_t count)
+{
+    const unsigned char *src = (const unsigned char *)data;
+
+    for (size_t i = 0; i < count; i++, src += stride)
+    {
+        unsigned short v;
+
+        memcpy(&v, src, sizeof(v));
+        dst[i] = FshortValue(v);
+    }
+}
+
+/*
+*  4 значения за шаг: дробная часть точно переводится во float (24 бита), затем к порядку
+*  результата прибавляется 4 * E - 280. Если порядок выходит за нормальный диапазон float,
+*  четверка пересчитывается поэлементно. Возвращает количество обработанных значений
+*/
+size_t CDLISConvert::IbmSSE2(unsigned int *data, size_t count)
+{
+    const __m128i  frac_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i  sign_mask = _mm_set1_epi32((int)0x80000000);
+    const __m128i  exp_mask  = _mm_set1_epi32(0x7F);
+    const __m128i  zero      = _mm_setzero_si128();
+    const __m128i  bias      = _mm_set1_epi32(280);
+    const __m128i  min_exp   = _mm_set1_epi32(1);
+    const __m128i  max_exp   = _mm_set1_epi32(254);
+    size_t         i;
+
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        __m128i  v, frac, bits, shift, exp, nonzero, bad;
+
+        v       = _mm_loadu_si128((const __m128i *)(data + i));
+        frac    = _mm_and_si128(v, frac_mask);
+        bits    = _mm_castps_si128(_mm_cvtepi32_ps(frac));
+        nonzero = _mm_xor_si128(_mm_cmpeq_epi32(frac, zero), _mm_set1_epi32(-1));
+
+        // сдвиг порядка 4 * E - 280 и итоговый порядок float
+        shift = _mm_sub_epi32(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 24), exp_mask), 2), bias);
+        exp   = _mm_add_epi32(_mm_srli_epi32(bits, 23), shift);
+
+        bad = _mm_and_si128(nonzero, _mm_or_si128(_mm_cmpgt_epi32(exp, max_exp), _mm_cmplt_epi32(exp, min_exp)));
+        if (_mm_movemask_epi8(bad))
+        {
+            for (size_t k = i; k < i + 4; k++)
+            {
+                float f = IbmValue(data[k]);
+                memcpy(&data[k], &f, sizeof(f));
+            }
+            continue;
+        }
+
+        bits = _mm_add_epi32(bits, _mm_slli_epi32(shift, 23));
+        bits = _mm_or_si128(bits, _mm_and_si128(v, sign_mask));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_and_si128(bits, nonzero));
+    }
+
+    return i;
+}
+
+/*
+*  4 значения за шаг: переставляем половины слова, при порядке больше 2 результат отличается
+*  от IEEE только смещением порядка (128 вместо 127 и скрытая единица после точки).
+*  Нулевой порядок дает ноль, порядки 1 и 2 (денормализованные во float) пересчитываются поэлементно
+*/
+size_t CDLISConvert::VaxSSE2(unsigned int *data, size_t count)
+{
+    const __m128i  byte_mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i  exp_mask  = _mm_set1_epi32(0xFF);
+    const __m128i  zero      = _mm_setzero_si128();
+    const __m128i  two       = _mm_set1_epi32(2);
+    const __m128i  exp_bias  = _mm_set1_epi32(2 << 23);
+    size_t         i;
+
+    for (i = 0; i + 4 <= count; i += 4)
+    {
+        __m128i  v, word, exp, nonzero, bad;
+
+        v    = _mm_loadu_si128((const __m128i *)(data + i));
+        word = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, byte_mask), 8), _mm_and_si128(_mm_srli_epi32(v, 8), byte_mask));
+        exp  = _mm_and_si128(_mm_srli_epi32(word, 23), exp_mask);
+
+        nonzero = _mm_xor_si128(_mm_cmpeq_epi32(exp, zero), _mm_set1_epi32(-1));
+        bad     = _mm_and_si128(nonzero, _mm_xor_si128(_mm_cmpgt_epi32(exp, two), _mm_set1_epi32(-1)));
+        if (_mm_movemask_epi8(bad))
+        {
+            for (size_t k = i; k < i + 4; k++)
+            {
+                float f = VaxValue(data[k]);
+                memcpy(&data[k], &f, sizeof(f));
+            }
+            continue;
+        }
+
+        word = _mm_sub_epi32(word, exp_bias);
+        _mm_storeu_si128((__m128i *)(data + i), _mm_and_si128(word, nonzero));
+    }
+
+    return i;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "stddef.h"
+
+// преобразование устаревших форматов с плавающей точкой (IBM, VAX, FSHORT) в IEEE float.
+// На входе значения уже развернуты из big endian (CDLISSwap): 32-битное слово b0 b1 b2 b3 файла
+// лежит в памяти как число (b0 << 24) | (b1 << 16) | (b2 << 8) | b3
+class CDLISConvert
+{
+public:
+    // ISINGL и VSINGL занимают 4 байта, как и float - преобразуем на месте
+    static void     IbmToFloat(void *data, size_t stride, size_t count);
+    static void     VaxToFloat(void *data, size_t stride, size_t count);
+    // FSHORT занимает 2 байта, результат пишется в отдельный массив dst подряд
+    static void     FshortToFloat(const void *data, size_t stride, float *dst, size_t count);
+
+    static float    IbmValue(unsigned int value);
+    static float    VaxValue(unsigned int value);
+    static float    FshortValue(unsigned short value);
+
+private:
+    static size_t   IbmSSE2(unsigned int *data, size_t count);
+    static size_t   VaxSSE2(unsigned int *data, size_t count);
+};
@@ -0,0 +1,476 @@
+#include "StdAfx.h"
+#include "DlisFile.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+
+#if defined(_WIN32)
+
+CDLISFile::CDLISFile() : m_file(INVALID_HANDLE_VALUE), m_mapping(NULL), m_view(NULL), m_view_size(0)
+{
+}
+
+
+CDLISFile::~CDLISFile()
+{
+    Close();
+}
+
+
+bool CDLISFile::Open(const wchar_t *file_name, unsigned int flags)
+{
+    DWORD   access, creation, attributes;
+
+    if (!file_name)
+        return false;
+
+    Close();
+
+    access     = GENERIC_READ;
+    creation   = OPEN_EXISTING;
+    attributes = FILE_ATTRIBUTE_NORMAL;
+
+    if (flags & FILE_WRITE)
+    {
+        access  |= GENERIC_WRITE;
+        creation = CREATE_ALWAYS;
+    }
+
+    if (flags & FILE_SEQUENTIAL)
+        attributes |= FILE_FLAG_SEQUENTIAL_SCAN;
+
+    if (flags & FILE_DIRECT)
+        attributes |= FILE_FLAG_NO_BUFFERING;
+
+    m_file = CreateFileW(file_name, access, FILE_SHARE_READ, NULL, creation, attributes, NULL);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+
+    return true;
+}
+
+
+bool CDLISFile::Open(const char *file_name, unsigned int flags)
+{
+    wchar_t  buf[MAX_PATH] = { 0 };
+
+    if (!file_name)
+        return false;
+
+    if (!MultiByteToWideChar(CP_ACP, 0, file_name, -1, buf, _countof(buf)))
+        return false;
+
+    return Open(buf, flags);
+}
+
+
+void CDLISFile::Close()
+{
+    Unmap();
+
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+}
+
+
+bool CDLISFile::IsOpen()
+{
+    return m_file != INVALID_HANDLE_VALUE;
+}
+
+
+bool CDLISFile::ReadAt(uint64_t offset, void *data, size_t len, size_t *readed)
+{
+    char  *dst = (char *)data;
+
+    *readed = 0;
+    // ReadFile читает не более DWORD за вызов
+    while (len)
+    {
+        OVERLAPPED  ov;
+        DWORD       part, done = 0;
+
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset     = (DWORD)(offset & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+
+        part = len > 0x40000000 ? 0x40000000 : (DWORD)len;
+
+        if (!ReadFile(m_file, dst, part, &done, &ov))
+        {
+            // чтение за концом файла
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            return false;
+        }
+
+        if (done == 0)
+            break;
+
+        *readed += done;
+        offset  += done;
+        dst     += done;
+        len     -= done;
+    }
+
+    return true;
+}
+
+
+bool CDLISFile::WriteAt(uint64_t offset, const void *data, size_t len)
+{
+    const char *src = (const char *)data;
+
+    while (len)
+    {
+        OVERLAPPED  ov;
+        DWORD       part, done = 0;
+
+        memset(&ov, 0, sizeof(ov));
+        ov.Offset     = (DWORD)(offset & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD)(offset >> 32);
+
+        part = len > 0x40000000 ? 0x40000000 : (DWORD)len;
+
+        if (!WriteFile(m_file, src, part, &done, &ov) || done != part)
+            return false;
+
+        offset += done;
+        src    += done;
+        len    -= done;
+    }
+
+    return true;
+}
+
+
+uint64_t CDLISFile::Size()
+{
+    LARGE_INTEGER  size;
+
+    if (!GetFileSizeEx(m_file, &size))
+        return 0;
+
+    return (uint64_t)size.QuadPart;
+}
+
+
+uint64_t CDLISFile::Time()
+{
+    FILETIME  write_time;
+
+    if (!GetFileTime(m_file, NULL, NULL, &write_time))
+        return 0;
+
+    return ((uint64_t)write_time.dwHighDateTime << 32) | write_time.dwLowDateTime;
+}
+
+
+bool CDLISFile::Map(char **data, uint64_t *size)
+{
+    uint64_t  file_size;
+
+    Unmap();
+
+    file_size = Size();
+    // пустой файл или файл не помещается в адресное пространство (32-х битная сборка)
+    if (file_size == 0 || file_size > (uint64_t)((size_t)-1))
+        return false;
+
+    m_mapping = CreateFileMapping(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!m_mapping)
+        return false;
+
+    m_view = (char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_view)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+        return false;
+    }
+
+    m_view_size = file_size;
+
+    *data = m_view;
+    *size = m_view_size;
+    return true;
+}
+
+
+void CDLISFile::Unmap()
+{
+    if (m_view)
+    {
+        UnmapViewOfFile(m_view);
+        m_view      = NULL;
+        m_view_size = 0;
+    }
+
+    if (m_mapping)
+    {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+}
+
+
+void CDLISFile::Prefetch(char *data, size_t len)
+{
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+    WIN32_MEMORY_RANGE_ENTRY  range;
+
+    range.VirtualAddress = data;
+    range.NumberOfBytes  = len;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    (void)data;
+    (void)len;
+#endif
+}
+
+
+void CDLISFile::DropCache(uint64_t offset, uint64_t len)
+{
+    // прямого аналога posix_fadvise(DONTNEED) нет: при FILE_FLAG_SEQUENTIAL_SCAN
+    // менеджер кэша сам освобождает прочитанные окна позади курсора
+    (void)offset;
+    (void)len;
+}
+
+
+void *CDLISFile::AllocAligned(size_t size)
+{
+    // VirtualAlloc выделяет память, выровненную на страницу
+    return VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+
+void CDLISFile::FreeAligned(void *data)
+{
+    if (data)
+        VirtualFree(data, 0, MEM_RELEASE);
+}
+
+#else
+
+CDLISFile::CDLISFile() : m_file(-1), m_view(NULL), m_view_size(0)
+{
+}
+
+
+CDLISFile::~CDLISFile()
+{
+    Close();
+}
+
+
+bool CDLISFile::Open(const wchar_t *file_name, unsigned int flags)
+{
+    char  buf[4096];
+
+    if (!file_name)
+        return false;
+
+    if (wcstombs(buf, file_name, sizeof(buf)) == (size_t)-1)
+        return false;
+
+    buf[sizeof(buf) - 1] = 0;
+    return Open(buf, flags);
+}
+
+
+bool CDLISFile::Open(const char *file_name, unsigned int flags)
+{
+    int   mode;
+
+    if (!file_name)
+        return false;
+
+    Close();
+
+    mode = O_RDONLY;
+    if (flags & FILE_WRITE)
+        mode = O_RDWR | O_CREAT | O_TRUNC;
+
+#if defined(O_DIRECT)
+    if (flags & FILE_DIRECT)
+        mode |= O_DIRECT;
+#endif
+
+    m_file = open(file_name, mode, 0644);
+    if (m_file < 0)
+        return false;
+
+    if (flags & FILE_SEQUENTIAL)
+        posix_fadvise(m_file, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    return true;
+}
+
+
+void CDLISFile::Close()
+{
+    Unmap();
+
+    if (m_file >= 0)
+    {
+        close(m_file);
+        m_file = -1;
+    }
+}
+
+
+bool CDLISFile::IsOpen()
+{
+    return m_file >= 0;
+}
+
+
+bool CDLISFile::ReadAt(uint64_t offset, void *data, size_t len, size_t *readed)
+{
+    char  *dst = (char *)data;
+
+    *readed = 0;
+    while (len)
+    {
+        ssize_t done;
+
+        done = pread(m_file, dst, len, (off_t)offset);
+        if (done < 0)
+            return false;
+
+        if (done == 0)
+            break;
+
+        *readed += done;
+        offset  += done;
+        dst     += done;
+        len     -= done;
+    }
+
+    return true;
+}
+
+
+bool CDLISFile::WriteAt(uint64_t offset, const void *data, size_t len)
+{
+    const char *src = (const char *)data;
+
+    while (len)
+    {
+        ssize_t done;
+
+        done = pwrite(m_file, src, len, (off_t)offset);
+        if (done <= 0)
+            return false;
+
+        offset += done;
+        src    += done;
+        len    -= done;
+    }
+
+    return true;
+}
+
+
+uint64_t CDLISFile::Size()
+{
+    struct stat st;
+
+    if (fstat(m_file, &st) != 0)
+        return 0;
+
+    return (uint64_t)st.st_size;
+}
+
+
+uint64_t CDLISFile::Time()
+{
+    struct stat st;
+
+    if (fstat(m_file, &st) != 0)
+        return 0;
+
+    return (uint64_t)st.st_mtime;
+}
+
+
+bool CDLISFile::Map(char **data, uint64_t *size)
+{
+    uint64_t  file_size;
+    void     *view;
+
+    Unmap();
+
+    file_size = Size();
+    if (file_size == 0 || file_size > (uint64_t)((size_t)-1))
+        return false;
+
+    view = mmap(NULL, (size_t)file_size, PROT_READ, MAP_SHARED, m_file, 0);
+    if (view == MAP_FAILED)
+        return false;
+
+    madvise(view, (size_t)file_size, MADV_SEQUENTIAL);
+
+    m_view      = (char *)view;
+    m_view_size = file_size;
+
+    *data = m_view;
+    *size = m_view_size;
+    return true;
+}
+
+
+void CDLISFile::Unmap()
+{
+    if (m_view)
+    {
+        munmap(m_view, (size_t)m_view_size);
+        m_view      = NULL;
+        m_view_size = 0;
+    }
+}
+
+
+void CDLISFile::Prefetch(char *data, size_t len)
+{
+    // madvise требует адрес, выровненный на страницу
+    uintptr_t  page  = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t  begin = (uintptr_t)data & ~(page - 1);
+
+    madvise((void *)begin, len + ((uintptr_t)data - begin), MADV_WILLNEED);
+}
+
+
+void CDLISFile::DropCache(uint64_t offset, uint64_t len)
+{
+    posix_fadvise(m_file, (off_t)offset, (off_t)len, POSIX_FADV_DONTNEED);
+}
+
+
+void *CDLISFile::AllocAligned(size_t size)
+{
+    void  *data = NULL;
+
+    if (posix_memalign(&data, DIRECT_ALIGN, size) != 0)
+        return NULL;
+
+    return data;
+}
+
+
+void CDLISFile::FreeAligned(void *data)
+{
+    free(data);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#if defined(_WIN32)
+#include "windows.h"
+#endif
+#include "stdint.h"
+#include "stddef.h"
+
+// платформенный слой доступа к файлу:
+// позиционное чтение (ReadFile с OVERLAPPED / pread) без общего курсора файла,
+// поэтому несколько читателей могут одновременно работать с одним открытым файлом
+class CDLISFile
+{
+public:
+    enum OpenFlags
+    {
+        FILE_READ       = 0x01,
+        FILE_WRITE      = 0x02,             // создать (перезаписать) файл для записи
+        FILE_SEQUENTIAL = 0x04,             // подсказка: файл читается последовательно
+        FILE_DIRECT     = 0x08,             // чтение мимо кэша (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+        //
+        DIRECT_ALIGN    = 4096,             // выравнивание смещения, длины и буфера при FILE_DIRECT
+    };
+
+private:
+#if defined(_WIN32)
+    HANDLE          m_file;
+    HANDLE          m_mapping;
+#else
+    int             m_file;
+#endif
+    char           *m_view;
+    uint64_t        m_view_size;
+
+public:
+    CDLISFile();
+    ~CDLISFile();
+
+    bool            Open(const wchar_t *file_name, unsigned int flags);
+    bool            Open(const char *file_name, unsigned int flags);
+    void            Close();
+    bool            IsOpen();
+
+    // чтение/запись len байт по смещению offset, позиция файла не используется
+    bool            ReadAt(uint64_t offset, void *data, size_t len, size_t *readed);
+    bool            WriteAt(uint64_t offset, const void *data, size_t len);
+    uint64_t        Size();
+    // время последней записи файла (FILETIME / st_mtime), 0 - не удалось получить
+    uint64_t        Time();
+
+    // отображение всего файла в память только для чтения
+    bool            Map(char **data, uint64_t *size);
+    void            Unmap();
+    // подсказка: диапазон отображения понадобится в ближайшее время
+    void            Prefetch(char *data, size_t len);
+    // подсказка: прочитанный диапазон файла больше не нужен, страницы можно выбросить из кэша
+    void            DropCache(uint64_t offset, uint64_t len);
+
+    // буфер, выровненный на DIRECT_ALIGN
+    static void    *AllocAligned(size_t size);
+    static void     FreeAligned(void *data);
+};
@@ -0,0 +1,67 @@
+#include "StdAfx.h"
+#include "DlisFrameCursor.h"
+#include "DLISParser.h"
+
+
+CDLISFrameCursor::CDLISFrameCursor(CDLISParser *parser) : m_parser(parser), m_error(false)
+{
+}
+
+
+CDLISFrameCursor::~CDLISFrameCursor()
+{
+}
+
+
+bool CDLISFrameCursor::Open(const wchar_t *file_name)
+{
+    if (!m_parser)
+        return false;
+
+    m_error = !m_parser->ParseBegin(file_name);
+    return !m_error;
+}
+
+
+bool CDLISFrameCursor::Open(CDLISSource *source)
+{
+    if (!m_parser)
+        return false;
+
+    m_error = !m_parser->ParseBegin(source);
+    return !m_error;
+}
+
+/*
+*  ресурсы разбора (объекты, буферы кадров) принадлежат парсеру и освобождаются в его Shutdown,
+*  парсер только выходит из режима курсора
+*/
+void CDLISFrameCursor::Close()
+{
+    if (m_parser)
+        m_parser->ParseEnd();
+
+    m_error = false;
+}
+
+
+CDLISFrame *CDLISFrameCursor::Next(int batch)
+{
+    CDLISFrame *frame;
+    bool        error;
+
+    if (!m_parser || m_error)
+        return NULL;
+
+    frame = m_parser->ParseNext(batch, &error);
+    if (error)
+        m_error = true;
+
+    return frame;
+}
+
+
+bool CDLISFrameCursor::IsError()
+{
+    return m_error;
+}
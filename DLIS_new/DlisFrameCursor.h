@@ -0,0 +1,31 @@
+#pragma once
+
+#include   "DlisCommon.h"
+
+class CDLISParser;
+class CDLISFrame;
+class CDLISSource;
+
+// чтение кадров по запросу вместо DlisNotifyCallback: разбор файла продвигается только
+// тогда, когда вызывающий просит следующий пакет. Кадры отдаются из буферов парсера без
+// копирования, поэтому пакет действителен до следующего вызова Next (или Close)
+class CDLISFrameCursor
+{
+private:
+    CDLISParser      *m_parser;
+    bool              m_error;
+
+public:
+    CDLISFrameCursor(CDLISParser *parser);
+    ~CDLISFrameCursor();
+
+    // читает заголовок файла, объекты EFLR разбираются по ходу Next
+    bool              Open(const wchar_t *file_name);
+    bool              Open(CDLISSource *source);
+    void              Close();
+
+    // следующий пакет: до batch кадров одного фрейма (0 - кадры одной IFLR),
+    // NULL - конец файла или ошибка разбора (см. IsError)
+    CDLISFrame       *Next(int batch = 0);
+    bool              IsError();
+};
@@ -0,0 +1,299 @@
+#include "StdAfx.h"
+#include "DlisIndex.h"
+
+
+static const char s_index_magic[8] = { 'D', 'L', 'I', 'S', 'I', 'D', 'X', 0 };
+
+
+CDLISIndex::CDLISIndex() : m_view(NULL), m_record_list(NULL), m_record_count(0), 
+    m_frame_list(NULL), m_frame_count(0), m_string_list(NULL)
+{
+}
+
+
+CDLISIndex::~CDLISIndex()
+{
+    Free();
+}
+
+
+void CDLISIndex::Free()
+{
+    if (m_view)
+    {
+        m_file.Unmap();
+        m_view = NULL;
+    }
+    m_file.Close();
+
+    m_records.clear();
+    m_frames.clear();
+    m_strings.clear();
+
+    Attach();
+}
+
+
+void CDLISIndex::RecordAdd(UINT64 vr_offset, unsigned short segment_pos, unsigned char type, unsigned char attributes)
+{
+    Record  record;
+
+    memset(&record, 0, sizeof(record));
+    record.vr_offset   = vr_offset;
+    record.segment_pos = segment_pos;
+    record.type        = type;
+    record.attributes  = attributes;
+    record.frame       = NO_FRAME;
+    record.first_frame = 0;
+    record.last_frame  = 0;
+    record.count       = 1;
+
+    m_records.push_back(record);
+    Attach();
+}
+
+/*
+*  IFLR: фрейм и диапазон номеров кадров последней добавленной записи,
+*  продолжение серии предыдущей записи присоединяем к ней
+*/
+void CDLISIndex::RecordFrame(int frame, UINT first_frame, UINT last_frame)
+{
+    Record  *record, *run;
+
+    if (m_records.empty())
+        return;
+
+    record = &m_records.back();
+    record->frame       = frame;
+    record->first_frame = first_frame;
+    record->last_frame  = last_frame;
+
+    if (m_records.size() < 2)
+        return;
+
+    run = record - 1;
+    if (IsExplicit(run) || run->frame != frame || run->type != record->type)
+        return;
+
+    if (first_frame <= run->last_frame || record->vr_offset - run->vr_offset >= RUN_BYTES)
+        return;
+
+    run->last_frame = last_frame;
+    run->count++;
+
+    m_records.pop_back();
+    Attach();
+}
+
+
+int CDLISIndex::FrameAdd(const DlisValueObjName *name, int logical_file)
+{
+    Frame   frame;
+    size_t  len;
+
+    len = strlen(name->identifier);
+
+    frame.logical_file     = (UINT)logical_file;
+    frame.origin_reference = name->origin_reference;
+    frame.copy_number      = name->copy_number;
+    frame.name_pos         = (UINT)m_strings.size();
+    frame.name_len         = (UINT)len;
+
+    // строки храним с завершающим нулем
+    m_strings.insert(m_strings.end(), name->identifier, name->identifier + len + 1);
+    m_frames.push_back(frame);
+
+    Attach();
+    return (int)(m_frames.size() - 1);
+}
+
+
+/*
+*  имена объектов уникальны только внутри логического файла
+*/
+int CDLISIndex::FrameFind(const DlisValueObjName *name, int logical_file)
+{
+    for (size_t i = 0; i < m_frame_count; i++)
+    {
+        const Frame *frame = &m_frame_list[i];
+
+        if (frame->logical_file != (UINT)logical_file)
+            continue;
+
+        if (frame->origin_reference == name->origin_reference && frame->copy_number == name->copy_number && 
+            strcmp(m_string_list + frame->name_pos, name->identifier) == 0)
+            return (int)i;
+    }
+
+    return NO_FRAME;
+}
+
+/*
+*  файл индекса: заголовок, записи, фреймы, строки
+*/
+bool CDLISIndex::Save(const wchar_t *index_name, CDLISFile *source)
+{
+    Header     header;
+    CDLISFile  file;
+    UINT64     offset;
+    size_t     records_len, frames_len, strings_len;
+
+    if (m_view)
+        return false;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, s_index_magic, sizeof(header.magic));
+    header.version      = INDEX_VERSION;
+    header.header_size  = sizeof(Header);
+    header.record_count = (UINT)m_records.size();
+    header.frame_count  = (UINT)m_frames.size();
+    header.strings_size = (UINT)m_strings.size();
+
+    if (!SourceHash(source, &header.source_size, &header.source_time, &header.source_hash))
+        return false;
+
+    records_len = m_records.size() * sizeof(Record);
+    frames_len  = m_frames.size() * sizeof(Frame);
+    strings_len = m_strings.size();
+
+    header.checksum = Hash(m_record_list, records_len, 14695981039346656037ULL);
+    header.checksum = Hash(m_frame_list, frames_len, header.checksum);
+    header.checksum = Hash(m_string_list, strings_len, header.checksum);
+
+    if (!file.Open(index_name, CDLISFile::FILE_WRITE))
+        return false;
+
+    // заголовок пишем последним: оборванная запись не даст валидный индекс
+    offset = sizeof(Header);
+
+    bool r = file.WriteAt(offset, m_record_list, records_len);
+    offset += records_len;
+
+    if (r)
+        r = file.WriteAt(offset, m_frame_list, frames_len);
+    offset += frames_len;
+
+    if (r)
+        r = file.WriteAt(offset, m_string_list, strings_len);
+
+    if (r)
+        r = file.WriteAt(0, &header, sizeof(header));
+
+    file.Close();
+    return r;
+}
+
+/*
+*  отображаем индекс в память и проверяем, что он построен для этого файла
+*/
+bool CDLISIndex::Load(const wchar_t *index_name, CDLISFile *source)
+{
+    const Header  *header;
+    UINT64         size, source_size, source_time, source_hash, checksum;
+    size_t         records_len, frames_len;
+
+    Free();
+
+    if (!SourceHash(source, &source_size, &source_time, &source_hash))
+        return false;
+
+    if (!m_file.Open(index_name, CDLISFile::FILE_READ))
+        return false;
+
+    if (!m_file.Map(&m_view, &size) || size < sizeof(Header))
+    {
+        Free();
+        return false;
+    }
+
+    header = (const Header *)m_view;
+
+    bool r = memcmp(header->magic, s_index_magic, sizeof(header->magic)) == 0;
+    if (r)
+        r = header->version == INDEX_VERSION && header->header_size == sizeof(Header);
+    if (r)
+        r = header->source_size == source_size && header->source_time == source_time && header->source_hash == source_hash;
+
+    records_len = (size_t)header->record_count * sizeof(Record);
+    frames_len  = (size_t)header->frame_count * sizeof(Frame);
+
+    if (r)
+        r = size == sizeof(Header) + records_len + frames_len + header->strings_size;
+
+    if (r)
+    {
+        checksum = Hash(m_view + sizeof(Header), (size_t)(size - sizeof(Header)), 14695981039346656037ULL);
+        r = checksum == header->checksum;
+    }
+
+    if (!r)
+    {
+        Free();
+        return false;
+    }
+
+    m_record_list  = (const Record *)(m_view + sizeof(Header));
+    m_record_count = header->record_count;
+    m_frame_list   = (const Frame *)(m_view + sizeof(Header) + records_len);
+    m_frame_count  = header->frame_count;
+    m_string_list  = m_view + sizeof(Header) + records_len + frames_len;
+
+    return true;
+}
+
+/*
+*  указатели доступа на данные строящегося индекса
+*/
+void CDLISIndex::Attach()
+{
+    m_record_list  = m_records.empty() ? NULL : &m_records[0];
+    m_record_count = m_records.size();
+    m_frame_list   = m_frames.empty()  ? NULL : &m_frames[0];
+    m_frame_count  = m_frames.size();
+    m_string_list  = m_strings.empty() ? NULL : &m_strings[0];
+}
+
+/*
+*  отпечаток индексируемого файла: размер, время последней записи и хэш первого и последнего блока
+*/
+bool CDLISIndex::SourceHash(CDLISFile *source, UINT64 *size, UINT64 *time, UINT64 *hash)
+{
+    std::vector<char>  buf(HASH_BLOCK);
+    size_t             readed;
+
+    if (!source || !source->IsOpen())
+        return false;
+
+    *size = source->Size();
+    *time = source->Time();
+    *hash = Hash(size, sizeof(*size), 14695981039346656037ULL);
+
+    if (!source->ReadAt(0, &buf[0], buf.size(), &readed))
+        return false;
+    *hash = Hash(&buf[0], readed, *hash);
+
+    if (*size > HASH_BLOCK)
+    {
+        if (!source->ReadAt(*size - HASH_BLOCK, &buf[0], buf.size(), &readed))
+            return false;
+        *hash = Hash(&buf[0], readed, *hash);
+    }
+
+    return true;
+}
+
+/*
+*  FNV-1a 64
+*/
+UINT64 CDLISIndex::Hash(const void *data, size_t len, UINT64 hash)
+{
+    const unsigned char *src = (const unsigned char *)data;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= src[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
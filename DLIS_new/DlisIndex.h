@@ -0,0 +1,111 @@
+#pragma once
+
+#include "windows.h"
+#include "DlisCommon.h"
+#include "DlisFile.h"
+
+#include <vector>
+
+// индекс логических записей файла DLIS, хранится рядом с файлом (или в каталоге кэша):
+// смещения записей, тип EFLR/IFLR, фрейм и диапазон номеров кадров для IFLR
+class CDLISIndex
+{
+public:
+    enum constants
+    {
+        INDEX_VERSION = 2,
+        HASH_BLOCK    = 64 * 1024,          // по началу и концу файла проверяем, что индекс от этого файла
+        NO_FRAME      = -1,
+        RUN_BYTES     = 1024 * 1024,        // предел серии IFLR одной записи индекса
+
+    };
+
+    struct Header
+    {
+        char            magic[8];
+        UINT            version;
+        UINT            header_size;
+        UINT64          source_size;
+        UINT64          source_hash;
+        // время последней записи файла: перезапись с тем же размером и краями тоже делает индекс устаревшим
+        UINT64          source_time;
+        UINT            record_count;
+        UINT            frame_count;
+        UINT            strings_size;
+        UINT            reserved;
+        // контрольная сумма данных индекса после заголовка
+        UINT64          checksum;
+    };
+
+    // логическая запись: первый сегмент лежит в visible record по смещению vr_offset,
+    // segment_pos - смещение заголовка сегмента от начала данных visible record;
+    // подряд идущие IFLR одного фрейма с растущими номерами кадров объединяются в серию из count записей;
+    // в конце структуры выравнивание, запись обнуляется целиком, чтобы в файл и в контрольную сумму не попадал мусор
+    struct Record
+    {
+        UINT64          vr_offset;
+        unsigned short  segment_pos;
+        unsigned char   type;
+        unsigned char   attributes;
+        int             frame;
+        UINT            first_frame;
+        UINT            last_frame;
+        UINT            count;
+    };
+
+    // имя объекта фрейма и номер логического файла, идентификатор лежит в таблице строк
+    struct Frame
+    {
+        UINT            logical_file;
+        UINT            origin_reference;
+        UINT            copy_number;
+        UINT            name_pos;
+        UINT            name_len;
+    };
+
+private:
+    // построение индекса
+    std::vector<Record>   m_records;
+    std::vector<Frame>    m_frames;
+    std::vector<char>     m_strings;
+
+    // загруженный индекс отображается из файла
+    CDLISFile             m_file;
+    char                 *m_view;
+
+    const Record         *m_record_list;
+    size_t                m_record_count;
+    const Frame          *m_frame_list;
+    size_t                m_frame_count;
+    const char           *m_string_list;
+
+public:
+    CDLISIndex();
+    ~CDLISIndex();
+
+    void            Free();
+
+    // построение во время разбора
+    void            RecordAdd(UINT64 vr_offset, unsigned short segment_pos, unsigned char type, unsigned char attributes);
+    void            RecordFrame(int frame, UINT first_frame, UINT last_frame);
+    int             FrameAdd(const DlisValueObjName *name, int logical_file);
+
+    // запись и загрузка, source - индексируемый файл
+    bool            Save(const wchar_t *index_name, CDLISFile *source);
+    bool            Load(const wchar_t *index_name, CDLISFile *source);
+
+    size_t          RecordCount()            { return m_record_count; }
+    const Record   *RecordGet(size_t index)  { return &m_record_list[index]; }
+    size_t          FrameCount()             { return m_frame_count; }
+    const Frame    *FrameGet(size_t index)   { return &m_frame_list[index]; }
+    // идентификатор фрейма, строка лежит в индексе
+    const char     *FrameName(size_t index)  { return m_string_list + m_frame_list[index].name_pos; }
+    int             FrameFind(const DlisValueObjName *name, int logical_file);
+
+    static bool     IsExplicit(const Record *record) { return (record->attributes & Logical_Record_Structure) != 0; }
+
+private:
+    void            Attach();
+    static bool     SourceHash(CDLISFile *source, UINT64 *size, UINT64 *time, UINT64 *hash);
+    static UINT64   Hash(const void *data, size_t len, UINT64 hash);
+};
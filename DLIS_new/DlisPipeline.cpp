@@ -0,0 +1,146 @@
+#include "StdAfx.h"
+#include "DlisPipeline.h"
+#if defined(_MSC_VER)
+#include "new.h"
+#endif
+
+
+CDLISPipeline::CDLISPipeline() : m_workers(NULL), m_count(0), m_depth(0), m_next(0), m_delivered(0),
+    m_notify_func(NULL), m_notify_params(NULL)
+{
+}
+
+
+CDLISPipeline::~CDLISPipeline()
+{
+    Stop();
+}
+
+
+bool CDLISPipeline::Start(int depth, int threads, DlisNotifyCallback func, void *params)
+{
+    Stop();
+
+    if (depth < 2 || threads < 1 || !func)
+        return false;
+
+    m_workers = new(std::nothrow) Worker[threads];
+    if (!m_workers)
+        return false;
+
+    m_count         = threads;
+    m_depth         = depth;
+    m_next          = 0;
+    m_delivered     = 0;
+    m_notify_func   = func;
+    m_notify_params = params;
+
+    for (int i = 0; i < threads; i++)
+    {
+        Worker *worker = &m_workers[i];
+
+        worker->first  = i;
+        worker->frames = new(std::nothrow) CDLISFrame[depth];
+        // в очереди может оказаться пакет каждого кадра и признак окончания
+        if (!worker->frames || !worker->filled.Initialize(depth + 1) || !worker->free.Initialize(depth))
+        {
+            Stop();
+            return false;
+        }
+
+        for (int k = 0; k < depth; k++)
+            worker->free.Push(&worker->frames[k]);
+    }
+
+    for (int i = 0; i < threads; i++)
+        m_workers[i].thread = std::thread(&CDLISPipeline::ThreadProc, this, &m_workers[i]);
+
+    return true;
+}
+
+
+void CDLISPipeline::Stop()
+{
+    if (!m_workers)
+        return;
+
+    for (int i = 0; i < m_count; i++)
+    {
+        Worker *worker = &m_workers[i];
+
+        if (worker->thread.joinable())
+        {
+            // NULL - признак окончания, поток выходит после всех пакетов перед ним
+            worker->filled.PushWait(NULL);
+            worker->thread.join();
+        }
+    }
+
+    for (int i = 0; i < m_count; i++)
+    {
+        Worker *worker = &m_workers[i];
+
+        if (worker->frames)
+        {
+            for (int k = 0; k < m_depth; k++)
+                worker->frames[k].Shutdown();
+
+            delete [] worker->frames;
+        }
+    }
+
+    delete [] m_workers;
+    m_workers = NULL;
+    m_count   = 0;
+    m_depth   = 0;
+}
+
+
+bool CDLISPipeline::IsStarted()
+{
+    return m_workers != NULL;
+}
+
+/*
+*  данные пакета не копируются: frame обменивается буферами со свободным пакетом потока
+*/
+void CDLISPipeline::Submit(CDLISFrame *frame)
+{
+    Worker     *worker = &m_workers[m_next];
+    CDLISFrame *out;
+
+    m_next = (m_next + 1) % m_count;
+
+    worker->free.PopWait(&out);
+
+    frame->Swap(out);
+    worker->filled.PushWait(out);
+}
+
+/*
+*  поток получает каждый m_count-й пакет, поэтому номер пакета известен без передачи;
+*  преобразовав пакет, поток ждет своей очереди на вызов callback
+*/
+void CDLISPipeline::ThreadProc(Worker *worker)
+{
+    CDLISFrame *frame;
+    UINT64      number = worker->first;
+
+    for (;;)
+    {
+        worker->filled.PopWait(&frame);
+        if (!frame)
+            break;
+
+        frame->Decode();
+
+        for (int spin = 0; m_delivered.load(std::memory_order_acquire) != number; spin++)
+            CDLISQueue<CDLISFrame *>::Wait(spin);
+
+        m_notify_func(frame, m_notify_params);
+        m_delivered.store(number + 1, std::memory_order_release);
+
+        number += m_count;
+        worker->free.PushWait(frame);
+    }
+}
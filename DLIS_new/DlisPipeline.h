@@ -0,0 +1,57 @@
+#pragma once
+
+#include "DLISFrame.h"
+#include "DlisQueue.h"
+
+#include <thread>
+#include <atomic>
+
+typedef void (*DlisNotifyCallback)(CDLISFrame *frame, void *params);
+
+// стадия преобразования кадров конвейера разбора: парсер (стадия разбора сегментов)
+// передает набранные пакеты кадров в потоки, которые переводят значения из big endian
+// в естественный вид и вызывают callback. Пакеты раздаются потокам по кругу, у каждого
+// потока две очереди SPSC: заполненные пакеты - к потоку, освободившиеся - обратно.
+// Преобразование идет параллельно, callback вызывается строго в порядке пакетов в файле
+class CDLISPipeline
+{
+private:
+    struct Worker
+    {
+        CDLISFrame                *frames;
+        CDLISQueue<CDLISFrame *>   filled;
+        CDLISQueue<CDLISFrame *>   free;
+        std::thread                thread;
+        // порядковый номер первого пакета потока, дальше через m_count
+        int                        first;
+
+        Worker() : frames(NULL), first(0) {}
+    };
+
+    Worker                    *m_workers;
+    int                        m_count;
+    int                        m_depth;
+    // поток, которому уйдет следующий пакет
+    int                        m_next;
+    // номер пакета, чья очередь вызывать callback
+    std::atomic<UINT64>        m_delivered;
+
+    DlisNotifyCallback         m_notify_func;
+    void                      *m_notify_params;
+
+public:
+    CDLISPipeline();
+    ~CDLISPipeline();
+
+    // depth - пакетов в работе на каждый поток (не меньше двух), threads - потоков преобразования
+    bool            Start(int depth, int threads, DlisNotifyCallback func, void *params);
+    // дожидается обработки переданных пакетов и останавливает потоки
+    void            Stop();
+    bool            IsStarted();
+
+    // меняет frame на свободный пакет (ждет, если все заняты), набранный уходит на преобразование
+    void            Submit(CDLISFrame *frame);
+
+private:
+    void            ThreadProc(Worker *worker);
+};
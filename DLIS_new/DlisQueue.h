@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// ограниченная очередь без блокировок для одного писателя и одного читателя (SPSC):
+// писатель двигает только m_tail, читатель - только m_head, одна ячейка кольца всегда пустая
+template <class T>
+class CDLISQueue
+{
+private:
+    enum constants
+    {
+        SPIN_YIELD = 64,                        // попыток с уступкой потока до засыпания
+        SPIN_SLEEP = 50,                        // мкс сна между попытками
+    };
+
+    T                    *m_items;
+    size_t                m_capacity;
+    std::atomic<size_t>   m_head;
+    std::atomic<size_t>   m_tail;
+
+public:
+    CDLISQueue() : m_items(NULL), m_capacity(0), m_head(0), m_tail(0) {}
+    ~CDLISQueue() { Free(); }
+
+    // capacity - сколько элементов может ждать в очереди
+    bool Initialize(size_t capacity)
+    {
+        Free();
+
+        m_items = new(std::nothrow) T[capacity + 1];
+        if (!m_items)
+            return false;
+
+        m_capacity = capacity + 1;
+        m_head     = 0;
+        m_tail     = 0;
+        return true;
+    }
+
+    void Free()
+    {
+        if (m_items)
+            delete [] m_items;
+
+        m_items    = NULL;
+        m_capacity = 0;
+    }
+
+    // false - очередь заполнена
+    bool Push(const T &item)
+    {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = tail + 1 == m_capacity ? 0 : tail + 1;
+
+        if (next == m_head.load(std::memory_order_acquire))
+            return false;
+
+        m_items[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // false - очередь пуста
+    bool Pop(T *item)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        *item = m_items[head];
+        m_head.store(head + 1 == m_capacity ? 0 : head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // ожидание места или элемента: сначала уступаем процессор, затем засыпаем,
+    // чтобы простаивающая стадия не занимала ядро
+    void PushWait(const T &item)
+    {
+        for (int spin = 0; !Push(item); spin++)
+            Wait(spin);
+    }
+
+    void PopWait(T *item)
+    {
+        for (int spin = 0; !Pop(item); spin++)
+            Wait(spin);
+    }
+
+    // ожидание других условий с той же стратегией
+    static void Wait(int spin)
+    {
+        if (spin < SPIN_YIELD)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(SPIN_SLEEP));
+    }
+};
@@ -0,0 +1,240 @@
+#include "StdAfx.h"
+#include "DlisReadAhead.h"
+#if defined(_MSC_VER)
+#include "new.h"
+#endif
+
+
+CDLISReadAhead::CDLISReadAhead() : m_source(NULL), m_remaind(0), m_slots(NULL), m_depth(0), m_chunk_size(0),
+    m_head(0), m_read_index(0), m_write_index(0), m_filled(0), m_stop(false), m_done(false), m_error(false)
+{
+}
+
+
+CDLISReadAhead::~CDLISReadAhead()
+{
+    Stop();
+}
+
+
+bool CDLISReadAhead::Start(CDLISSource *source, UINT64 size, int depth, size_t chunk_size, size_t head)
+{
+    Stop();
+
+    if (!source || depth < 1 || chunk_size == 0)
+        return false;
+
+    m_slots = new(std::nothrow) Slot[depth];
+    if (!m_slots)
+        return false;
+
+    memset(m_slots, 0, sizeof(Slot) * depth);
+    for (int i = 0; i < depth; i++)
+    {
+        if (!m_slots[i].Resize(head + chunk_size))
+        {
+            Stop();
+            return false;
+        }
+    }
+
+    m_source       = source;
+    m_remaind      = size;
+    m_depth        = depth;
+    m_chunk_size   = chunk_size;
+    m_head         = head;
+    m_read_index   = 0;
+    m_write_index  = 0;
+    m_filled       = 0;
+    m_stop         = false;
+    m_done         = false;
+    m_error        = false;
+
+    m_thread = std::thread(&CDLISReadAhead::ThreadProc, this);
+    return true;
+}
+
+
+void CDLISReadAhead::Stop()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stop = true;
+        }
+        m_cond_free.notify_all();
+        m_thread.join();
+    }
+
+    if (m_slots)
+    {
+        for (int i = 0; i < m_depth; i++)
+            m_slots[i].Free();
+
+        delete [] m_slots;
+        m_slots = NULL;
+    }
+
+    m_source = NULL;
+    m_depth  = 0;
+    m_filled = 0;
+}
+
+
+bool CDLISReadAhead::IsStarted()
+{
+    return m_slots != NULL;
+}
+
+
+bool CDLISReadAhead::Read(char *data, size_t len, size_t *readed)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    *readed = 0;
+    while (len)
+    {
+        // ждем пока поток-читатель заполнит очередной буфер
+        while (m_filled == 0 && !m_done)
+            m_cond_filled.wait(lock);
+
+        // данные закончились
+        if (m_filled == 0)
+            break;
+
+        Slot   *slot = &m_slots[m_read_index];
+        size_t  part = slot->size - slot->pos;
+
+        if (part > len)
+            part = len;
+
+        memcpy(data, slot->data + m_head + slot->pos, part);
+        slot->pos += part;
+        data      += part;
+        len       -= part;
+        *readed   += part;
+
+        // буфер прочитан полностью, возвращаем его потоку-читателю
+        if (slot->pos == slot->size)
+        {
+            m_read_index = (m_read_index + 1) % m_depth;
+            m_filled--;
+            m_cond_free.notify_one();
+        }
+    }
+
+    // ошибку чтения отдаем только после всех успешно прочитанных данных
+    if (len && m_error)
+        return false;
+
+    return true;
+}
+
+
+bool CDLISReadAhead::Swap(MemoryBuffer *buffer, size_t keep_pos, size_t keep_len, size_t *pos, size_t *readed)
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    *pos    = keep_pos;
+    *readed = 0;
+
+    // ждем пока поток-читатель заполнит очередной буфер
+    while (m_filled == 0 && !m_done)
+        m_cond_filled.wait(lock);
+
+    // данные закончились
+    if (m_filled == 0)
+        return !m_error;
+
+    Slot   *slot  = &m_slots[m_read_index];
+    size_t  start = m_head + slot->pos;
+
+    if (keep_len > start)
+        return false;
+
+    // остаток прежнего буфера - вплотную перед новыми данными
+    start -= keep_len;
+    memcpy(slot->data + start, buffer->data + keep_pos, keep_len);
+
+    *pos    = start;
+    *readed = slot->size - slot->pos;
+
+    // буфер уходит вызывающему, его прежний буфер поток-читатель заполнит следующим
+    char   *data     = buffer->data;
+    size_t  max_size = buffer->max_size;
+
+    buffer->data     = slot->data;
+    buffer->max_size = slot->max_size;
+    buffer->size     = start + keep_len + *readed;
+
+    slot->data       = data;
+    slot->max_size   = max_size;
+    slot->size       = 0;
+    slot->pos        = 0;
+
+    m_read_index = (m_read_index + 1) % m_depth;
+    m_filled--;
+    m_cond_free.notify_one();
+
+    return true;
+}
+
+
+void CDLISReadAhead::ThreadProc()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+
+    while (!m_stop && m_remaind)
+    {
+        // ждем свободный буфер
+        while (m_filled == m_depth && !m_stop)
+            m_cond_free.wait(lock);
+
+        if (m_stop)
+            break;
+
+        Slot   *slot = &m_slots[m_write_index];
+        size_t  amount;
+
+        if ((UINT64)m_chunk_size > m_remaind)
+            amount = (size_t)m_remaind;
+        else
+            amount = m_chunk_size;
+
+        // читаем без блокировки, парсер в это время разбирает уже заполненные буферы.
+        // Буфер мог прийти от парсера (Swap) и быть меньше нужного
+        lock.unlock();
+
+        bool    r;
+        size_t  readed = 0;
+
+        r = slot->Resize(m_head + amount);
+        if (r)
+            r = m_source->Read(slot->data + m_head, amount, &readed);
+
+        lock.lock();
+
+        if (!r || readed == 0)
+        {
+            m_error = !r;
+            break;
+        }
+
+        slot->size = readed;
+        slot->pos  = 0;
+
+        // источник закончился раньше (поток без известного размера)
+        if (readed < amount)
+            m_remaind = 0;
+        else
+            m_remaind -= readed;
+        m_write_index   = (m_write_index + 1) % m_depth;
+        m_filled++;
+
+        m_cond_filled.notify_one();
+    }
+
+    m_done = true;
+    m_cond_filled.notify_all();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "windows.h"
+#include "MemoryBuffer.h"
+#include "DlisSource.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// упреждающее чтение файла в отдельном потоке:
+// поток-читатель заполняет кольцо из depth буферов, пока парсер разбирает текущий.
+// Данные в буфере лежат после запаса head байт: парсер забирает заполненный буфер целиком
+// (Swap), переносит в запас недочитанный остаток прежнего, а прежний буфер уходит на место
+// забранного и заполняется при следующем чтении
+class CDLISReadAhead
+{
+private:
+    struct Slot : MemoryBuffer
+    {
+        size_t       pos;
+    };
+
+private:
+    CDLISSource             *m_source;
+    UINT64                   m_remaind;
+
+    Slot                    *m_slots;
+    int                      m_depth;
+    size_t                   m_chunk_size;
+    size_t                   m_head;
+
+    // индекс буфера для чтения парсером, индекс буфера для заполнения потоком
+    int                      m_read_index;
+    int                      m_write_index;
+    int                      m_filled;
+
+    bool                     m_stop;
+    // поток-читатель закончил работу (конец файла или ошибка)
+    bool                     m_done;
+    bool                     m_error;
+
+    std::thread              m_thread;
+    std::mutex               m_lock;
+    std::condition_variable  m_cond_filled;
+    std::condition_variable  m_cond_free;
+
+public:
+    CDLISReadAhead();
+    ~CDLISReadAhead();
+
+    // size - сколько байт прочитать из источника, (UINT64)-1 - до конца данных,
+    // head - запас перед данными каждого буфера под остаток прежнего
+    bool            Start(CDLISSource *source, UINT64 size, int depth, size_t chunk_size, size_t head);
+    void            Stop();
+    bool            IsStarted();
+
+    // копирует до len байт из заполненных буферов, при необходимости ждет поток-читатель
+    bool            Read(char *data, size_t len, size_t *readed);
+    // меняет buffer на очередной заполненный буфер, при необходимости ждет поток-читатель.
+    // keep_len байт с keep_pos прежнего буфера (не больше head) переносятся перед новыми данными:
+    // они начинаются в buffer->data + *pos, новых данных *readed байт (0 - данные закончились,
+    // buffer не меняется)
+    bool            Swap(MemoryBuffer *buffer, size_t keep_pos, size_t keep_len, size_t *pos, size_t *readed);
+
+private:
+    void            ThreadProc();
+};
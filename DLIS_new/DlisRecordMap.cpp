@@ -0,0 +1,82 @@
+#include "StdAfx.h"
+#include "DlisRecordMap.h"
+
+
+CDLISRecordMap::CDLISRecordMap()
+{
+}
+
+
+CDLISRecordMap::~CDLISRecordMap()
+{
+}
+
+
+bool CDLISRecordMap::Build(CDLISFile *file)
+{
+    UINT64   offset, size;
+
+    Free();
+
+    if (!file || !file->IsOpen())
+        return false;
+
+    size   = file->Size();
+    offset = STORAGE_UNIT_LABEL_SIZE;
+
+    // грубая оценка: visible record обычно не меньше 8 Кб
+    m_records.reserve((size_t)(size / (8 * 1024)) + 1);
+
+    while (offset < size)
+    {
+        unsigned char  probe[RECORD_PROBE_SIZE];
+        size_t         readed = 0;
+        Record         record;
+
+        if (!file->ReadAt(offset, probe, sizeof(probe), &readed))
+            return false;
+
+        // обрезанный хвост файла: меньше заголовков записи и первого сегмента
+        if (readed < RECORD_PROBE_SIZE)
+            break;
+
+        // заголовок visible record: длина (big endian) и версия формата 0xFF 0x01
+        if (probe[2] != 0xFF || probe[3] != 0x01)
+            return false;
+
+        record.offset = offset;
+        record.length = (unsigned short)((probe[0] << 8) | probe[1]);
+
+        if (record.length <= RECORD_PROBE_SIZE)
+            return false;
+
+        // заголовок первого сегмента: длина (2 байта), атрибуты, тип
+        record.attributes = ReverseBits(probe[6]);
+        record.type       = probe[7];
+
+        m_records.push_back(record);
+        offset += record.length;
+    }
+
+    return true;
+}
+
+
+void CDLISRecordMap::Free()
+{
+    m_records.clear();
+}
+
+/*
+*  байт атрибутов сегмента хранится в обратном порядке бит (как в CDLISParser::Big2LittelEndianByte)
+*/
+unsigned char CDLISRecordMap::ReverseBits(unsigned char src)
+{
+    unsigned char dst = 0;
+
+    for (int i = 0; i < 8; i++)
+        if ((0x1 << i) & src)
+            dst |= (0x80 >> i);
+
+    return dst;
+}
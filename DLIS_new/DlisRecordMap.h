@@ -0,0 +1,52 @@
+#pragma once
+
+#include "windows.h"
+#include "DlisCommon.h"
+#include "DlisFile.h"
+
+#include <vector>
+
+// карта visible record файла DLIS: строится переходами от заголовка к заголовку
+// позиционным чтением, данные записей не читаются
+class CDLISRecordMap
+{
+public:
+    enum constants
+    {
+        STORAGE_UNIT_LABEL_SIZE = sizeof(StorageUnitLabel),
+        // заголовок visible record + заголовок первого сегмента
+        RECORD_PROBE_SIZE       = sizeof(VisibleRecordHeader) + 4,
+    };
+
+    struct Record
+    {
+        // смещение visible record в файле
+        UINT64          offset;
+        // длина visible record вместе с заголовком
+        unsigned short  length;
+        // тип логической записи первого сегмента
+        unsigned char   type;
+        // атрибуты первого сегмента (LogicalRecordSegmentAttributes)
+        unsigned char   attributes;
+    };
+
+private:
+    std::vector<Record>   m_records;
+
+public:
+    CDLISRecordMap();
+    ~CDLISRecordMap();
+
+    bool            Build(CDLISFile *file);
+    void            Free();
+
+    size_t          Count()            { return m_records.size(); }
+    Record         *Get(size_t index)  { return &m_records[index]; }
+
+    // первый сегмент записи: EFLR или IFLR, начало логической записи или продолжение
+    static bool     IsExplicit(const Record *record)  { return (record->attributes & Logical_Record_Structure) != 0; }
+    static bool     IsContinued(const Record *record) { return (record->attributes & Predecessor) != 0; }
+
+private:
+    static unsigned char  ReverseBits(unsigned char src);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "DlisCommon.h"
+
+// свойства representation code фиксированной длины, известные при компиляции:
+// тип значения в памяти, длина в файле, нужен ли разворот байт, знаковый ли тип.
+// Коды переменной длины (UVARI, IDENT, ASCII, ...) и составные коды читаются отдельными функциями
+template <RepresentationCodes code> struct DlisRepCode;
+
+#define DLIS_REP_CODE(rep_code, value_type, value_size, value_swap, value_signed)  \
+    template <> struct DlisRepCode<rep_code>                                       \
+    {                                                                              \
+        typedef value_type type;                                                   \
+        enum                                                                       \
+        {                                                                          \
+            size        = value_size,                                              \
+            swap        = value_swap,                                              \
+            is_signed   = value_signed,                                            \
+        };                                                                         \
+    };
+
+//            code        type              size  swap  signed
+DLIS_REP_CODE(RC_FSHORT,  unsigned short,   2,    1,    1)
+DLIS_REP_CODE(RC_FSINGL,  float,            4,    1,    1)
+DLIS_REP_CODE(RC_ISINGL,  unsigned int,     4,    1,    1)
+DLIS_REP_CODE(RC_VSINGL,  unsigned int,     4,    1,    1)
+DLIS_REP_CODE(RC_FDOUBL,  double,           8,    1,    1)
+DLIS_REP_CODE(RC_SSHORT,  signed char,      1,    0,    1)
+DLIS_REP_CODE(RC_SNORM,   short,            2,    1,    1)
+DLIS_REP_CODE(RC_SLONG,   int,              4,    1,    1)
+DLIS_REP_CODE(RC_USHORT,  unsigned char,    1,    0,    0)
+DLIS_REP_CODE(RC_UNORM,   unsigned short,   2,    1,    0)
+DLIS_REP_CODE(RC_ULONG,   unsigned int,     4,    1,    0)
+DLIS_REP_CODE(RC_STATUS,  unsigned char,    1,    0,    0)
+
+#undef DLIS_REP_CODE
@@ -0,0 +1,286 @@
+#include "StdAfx.h"
+#include "DlisSource.h"
+
+
+CDLISFileSource::CDLISFileSource() : m_offset(0), m_cache_mode(CACHE_NORMAL), m_dropped(0),
+    m_direct(NULL), m_direct_pos(0), m_direct_size(0)
+{
+}
+
+
+CDLISFileSource::~CDLISFileSource()
+{
+    Close();
+}
+
+
+void CDLISFileSource::SetCacheMode(CacheMode mode)
+{
+    m_cache_mode = mode;
+}
+
+
+bool CDLISFileSource::Open(const wchar_t *file_name)
+{
+    unsigned int  flags;
+
+    Close();
+
+    flags = CDLISFile::FILE_READ | CDLISFile::FILE_SEQUENTIAL;
+    if (m_cache_mode == CACHE_DIRECT)
+    {
+        m_direct = (char *)CDLISFile::AllocAligned(DIRECT_CHUNK);
+        if (!m_direct)
+            return false;
+
+        flags |= CDLISFile::FILE_DIRECT;
+    }
+
+    return m_file.Open(file_name, flags);
+}
+
+
+void CDLISFileSource::Close()
+{
+    m_file.Close();
+    m_offset  = 0;
+    m_dropped = 0;
+
+    CDLISFile::FreeAligned(m_direct);
+    m_direct      = NULL;
+    m_direct_pos  = 0;
+    m_direct_size = 0;
+}
+
+
+bool CDLISFileSource::Read(char *data, size_t len, size_t *readed)
+{
+    if (m_direct)
+    {
+        if (!ReadDirect(data, len, readed))
+            return false;
+    }
+    else
+    {
+        if (!m_file.ReadAt(m_offset, data, len, readed))
+            return false;
+    }
+
+    m_offset += *readed;
+
+    // файл читается один раз, выбрасываем из кэша все что позади курсора
+    if (m_cache_mode == CACHE_DROP_BEHIND && m_offset - m_dropped >= DROP_CHUNK)
+    {
+        m_file.DropCache(m_dropped, m_offset - m_dropped);
+        m_dropped = m_offset;
+    }
+
+    return true;
+}
+
+/*
+*  прямое чтение: с диска читаем только выровненные блоки в выровненный буфер,
+*  блоки идут подряд с начала файла, поэтому смещение всегда кратно DIRECT_CHUNK
+*/
+bool CDLISFileSource::ReadDirect(char *data, size_t len, size_t *readed)
+{
+    *readed = 0;
+    while (len)
+    {
+        if (m_direct_pos == m_direct_size)
+        {
+            UINT64  offset = m_offset + *readed;
+
+            m_direct_pos  = 0;
+            m_direct_size = 0;
+            // последний блок файла читается не полностью
+            if (!m_file.ReadAt(offset, m_direct, DIRECT_CHUNK, &m_direct_size))
+                return false;
+
+            if (m_direct_size == 0)
+                break;
+        }
+
+        size_t part = m_direct_size - m_direct_pos;
+        if (part > len)
+            part = len;
+
+        memcpy(data, m_direct + m_direct_pos, part);
+        m_direct_pos += part;
+        data         += part;
+        len          -= part;
+        *readed      += part;
+    }
+
+    return true;
+}
+
+
+bool CDLISFileSource::Size(UINT64 *size)
+{
+    *size = m_file.Size();
+    return true;
+}
+
+
+/*
+*  при прямом чтении с диска читаются только выровненные блоки: читаем блок, в котором лежит offset,
+*  и встаем в нем на нужное место, следующий блок снова выровнен
+*/
+bool CDLISFileSource::Seek(UINT64 offset)
+{
+    if (!m_file.IsOpen())
+        return false;
+
+    if (m_direct)
+    {
+        UINT64 block = offset - offset % DIRECT_CHUNK;
+
+        m_direct_pos  = 0;
+        m_direct_size = 0;
+        if (!m_file.ReadAt(block, m_direct, DIRECT_CHUNK, &m_direct_size))
+            return false;
+
+        m_direct_pos = (size_t)(offset - block);
+        if (m_direct_pos > m_direct_size)
+            m_direct_pos = m_direct_size;
+    }
+
+    m_offset  = offset;
+    m_dropped = offset;
+
+    return true;
+}
+
+
+bool CDLISFileSource::Map(char **data, UINT64 *size)
+{
+    // отображение работает через кэш ОС
+    if (m_cache_mode == CACHE_DIRECT)
+        return false;
+
+    return m_file.Map(data, size);
+}
+
+
+void CDLISFileSource::Unmap()
+{
+    m_file.Unmap();
+}
+
+
+void CDLISFileSource::Prefetch(char *data, size_t len)
+{
+    m_file.Prefetch(data, len);
+}
+
+
+CDLISStreamSource::CDLISStreamSource() : m_stream(NULL)
+{
+}
+
+
+CDLISStreamSource::~CDLISStreamSource()
+{
+}
+
+
+void CDLISStreamSource::Attach(FILE *stream)
+{
+    m_stream = stream;
+}
+
+
+bool CDLISStreamSource::Read(char *data, size_t len, size_t *readed)
+{
+    *readed = 0;
+
+    if (!m_stream)
+        return false;
+
+    // pipe может отдавать данные частями, дочитываем до len или до конца потока
+    while (len)
+    {
+        size_t  done;
+
+        done = fread(data, 1, len, m_stream);
+        if (done == 0)
+            break;
+
+        *readed += done;
+        data    += done;
+        len     -= done;
+    }
+
+    return ferror(m_stream) == 0;
+}
+
+
+bool CDLISStreamSource::Size(UINT64 *size)
+{
+    *size = 0;
+    return false;
+}
+
+
+CDLISMemorySource::CDLISMemorySource() : m_data(NULL), m_size(0), m_offset(0)
+{
+}
+
+
+CDLISMemorySource::~CDLISMemorySource()
+{
+}
+
+
+void CDLISMemorySource::Attach(const void *data, size_t size)
+{
+    m_data   = (const char *)data;
+    m_size   = size;
+    m_offset = 0;
+}
+
+
+bool CDLISMemorySource::Read(char *data, size_t len, size_t *readed)
+{
+    if (!m_data)
+        return false;
+
+    if (len > m_size - m_offset)
+        len = m_size - m_offset;
+
+    memcpy(data, m_data + m_offset, len);
+    m_offset += len;
+    *readed   = len;
+
+    return true;
+}
+
+
+bool CDLISMemorySource::Size(UINT64 *size)
+{
+    *size = m_size;
+    return true;
+}
+
+
+bool CDLISMemorySource::Seek(UINT64 offset)
+{
+    if (!m_data || offset > m_size)
+        return false;
+
+    m_offset = (size_t)offset;
+    return true;
+}
+
+
+bool CDLISMemorySource::Map(char **data, UINT64 *size)
+{
+    if (!m_data || !m_size)
+        return false;
+
+    // парсер только читает данные из отображения
+    *data = (char *)m_data;
+    *size = m_size;
+    return true;
+}
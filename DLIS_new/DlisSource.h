@@ -0,0 +1,118 @@
+#pragma once
+
+#include "windows.h"
+#include "stdio.h"
+#include "DlisFile.h"
+
+// источник байтов для CDLISParser: файл, поток (pipe, stdin, вывод распаковщика) и т.д.
+class CDLISSource
+{
+public:
+    virtual ~CDLISSource() {}
+
+    // читает до len байт, *readed меньше len только в конце данных
+    virtual bool    Read(char *data, size_t len, size_t *readed) = 0;
+    // размер данных, false - размер заранее неизвестен (поток)
+    virtual bool    Size(UINT64 *size) = 0;
+    // переход на смещение offset от начала данных, false - источник читается только последовательно
+    virtual bool    Seek(UINT64 offset) { return false; }
+
+    // весь образ уже лежит в памяти, отображать его нужно всегда
+    virtual bool    InMemory() { return false; }
+    // весь образ доступен в памяти без копирования
+    virtual bool    Map(char **data, UINT64 *size) { return false; }
+    virtual void    Unmap() {}
+    // подсказка: диапазон отображения понадобится в ближайшее время
+    virtual void    Prefetch(char *data, size_t len) {}
+};
+
+// файл на диске
+class CDLISFileSource : public CDLISSource
+{
+public:
+    // работа с кэшем ОС при однократном чтении больших файлов
+    enum CacheMode
+    {
+        CACHE_NORMAL      = 0,              // обычное чтение через кэш
+        CACHE_DROP_BEHIND = 1,              // выбрасываем из кэша уже прочитанные страницы
+        CACHE_DIRECT      = 2,              // чтение мимо кэша выровненными блоками
+    };
+
+private:
+    enum constants
+    {
+        DROP_CHUNK   = 32 * 1024 * 1024,    // шаг сброса кэша позади курсора
+        DIRECT_CHUNK = 4 * 1024 * 1024,     // размер блока прямого чтения, кратен CDLISFile::DIRECT_ALIGN
+    };
+
+    CDLISFile       m_file;
+    UINT64          m_offset;
+
+    CacheMode       m_cache_mode;
+    UINT64          m_dropped;
+
+    // выровненный буфер прямого чтения
+    char           *m_direct;
+    size_t          m_direct_pos;
+    size_t          m_direct_size;
+
+public:
+    CDLISFileSource();
+    virtual ~CDLISFileSource();
+
+    // режим задается до Open
+    void            SetCacheMode(CacheMode mode);
+    CacheMode       GetCacheMode() { return m_cache_mode; }
+    bool            Open(const wchar_t *file_name);
+    void            Close();
+    CDLISFile      *File() { return &m_file; }
+
+    virtual bool    Read(char *data, size_t len, size_t *readed);
+    virtual bool    Size(UINT64 *size);
+    virtual bool    Seek(UINT64 offset);
+
+    virtual bool    Map(char **data, UINT64 *size);
+    virtual void    Unmap();
+    virtual void    Prefetch(char *data, size_t len);
+
+private:
+    bool            ReadDirect(char *data, size_t len, size_t *readed);
+};
+
+// последовательный поток без известного размера, читается до EOF
+class CDLISStreamSource : public CDLISSource
+{
+private:
+    FILE           *m_stream;
+
+public:
+    CDLISStreamSource();
+    virtual ~CDLISStreamSource();
+
+    void            Attach(FILE *stream);
+
+    virtual bool    Read(char *data, size_t len, size_t *readed);
+    virtual bool    Size(UINT64 *size);
+};
+
+// образ DLIS в памяти вызывающего, данные не копируются
+class CDLISMemorySource : public CDLISSource
+{
+private:
+    const char     *m_data;
+    size_t          m_size;
+    size_t          m_offset;
+
+public:
+    CDLISMemorySource();
+    virtual ~CDLISMemorySource();
+
+    void            Attach(const void *data, size_t size);
+
+    virtual bool    Read(char *data, size_t len, size_t *readed);
+    virtual bool    Size(UINT64 *size);
+    virtual bool    Seek(UINT64 offset);
+
+    virtual bool    InMemory() { return true; }
+    virtual bool    Map(char **data, UINT64 *size);
+};
@@ -0,0 +1,197 @@
+#include "StdAfx.h"
+#include "DlisSwap.h"
+
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#define DLIS_TARGET_SSSE3
+#define DLIS_TARGET_AVX2
+#else
+#include <cpuid.h>
+#include <immintrin.h>
+#define DLIS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define DLIS_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+
+
+// уровень определяется один раз при загрузке модуля, до запуска потоков разбора
+CDLISSwap::Level CDLISSwap::s_level = CDLISSwap::Detect();
+
+// маски pshufb: разворот байт внутри каждого значения 16-байтовой полосы
+static const unsigned char s_shuffle16[16] = { 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 };
+static const unsigned char s_shuffle32[16] = { 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12 };
+static const unsigned char s_shuffle64[16] = { 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8 };
+
+
+static const unsigned char *ShuffleMask(size_t size)
+{
+    switch (size)
+    {
+        case 2:  return s_shuffle16;
+        case 4:  return s_shuffle32;
+        case 8:  return s_shuffle64;
+    }
+
+    return NULL;
+}
+
+
+void CDLISSwap::Swap(void *data, size_t size, size_t count)
+{
+    unsigned char *src = (unsigned char *)data;
+    size_t         done = 0;
+
+    if (size != 2 && size != 4 && size != 8)
+        return;
+
+    if (s_level >= LEVEL_AVX2)
+        done = SwapAVX2(src, size, count);
+    else if (s_level >= LEVEL_SSSE3)
+        done = SwapSSSE3(src, size, count);
+
+    // хвост, не кратный ширине регистра
+    SwapScalar(src + done * size, size, size, count - done);
+}
+
+/*
+*  значения столбца разбросаны с шагом кадра, векторная загрузка не помогает - меняем поэлементно.
+*  Сбор столбца в непрерывный буфер, векторный разворот и раскладка обратно проверены:
+*  два прохода копирования медленнее одного bswap на значение примерно вдвое при любом шаге
+*/
+void CDLISSwap::SwapStrided(void *data, size_t size, size_t stride, size_t count)
+{
+    if (stride == size)
+        Swap(data, size, count);
+    else
+        SwapScalar((unsigned char *)data, size, stride, count);
+}
+
+
+CDLISSwap::Level CDLISSwap::GetLevel()
+{
+    return s_level;
+}
+
+
+void CDLISSwap::SwapScalar(unsigned char *data, size_t size, size_t stride, size_t count)
+{
+    switch (size)
+    {
+        case 2:
+            for (size_t i = 0; i < count; i++, data += stride)
+            {
+                unsigned short v;
+                memcpy(&v, data, sizeof(v));
+                v = DLIS_BSWAP16(v);
+                memcpy(data, &v, sizeof(v));
+            }
+            break;
+
+        case 4:
+            for (size_t i = 0; i < count; i++, data += stride)
+            {
+                unsigned int v;
+                memcpy(&v, data, sizeof(v));
+                v = DLIS_BSWAP32(v);
+                memcpy(data, &v, sizeof(v));
+            }
+            break;
+
+        case 8:
+            for (size_t i = 0; i < count; i++, data += stride)
+            {
+                unsigned long long v;
+                memcpy(&v, data, sizeof(v));
+                v = DLIS_BSWAP64(v);
+                memcpy(data, &v, sizeof(v));
+            }
+            break;
+    }
+}
+
+/*
+*  16 байт за шаг, возвращает количество обработанных значений
+*/
+DLIS_TARGET_SSSE3
+size_t CDLISSwap::SwapSSSE3(unsigned char *data, size_t size, size_t count)
+{
+    __m128i  mask;
+    size_t   len, i;
+
+    mask = _mm_loadu_si128((const __m128i *)ShuffleMask(size));
+    len  = (count * size) & ~(size_t)15;
+
+    for (i = 0; i < len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_shuffle_epi8(v, mask));
+    }
+
+    return len / size;
+}
+
+/*
+*  32 байта за шаг, pshufb работает внутри 128-битных половин, маска в обеих одинаковая
+*/
+DLIS_TARGET_AVX2
+size_t CDLISSwap::SwapAVX2(unsigned char *data, size_t size, size_t count)
+{
+    __m256i  mask;
+    size_t   len, i;
+
+    mask = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)ShuffleMask(size)));
+    len  = (count * size) & ~(size_t)31;
+
+    for (i = 0; i < len; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+        _mm256_storeu_si256((__m256i *)(data + i), _mm256_shuffle_epi8(v, mask));
+    }
+
+    return len / size;
+}
+
+/*
+*  SSSE3: CPUID.1:ECX[9]; AVX2: CPUID.7:EBX[5] и поддержка сохранения YMM операционной системой (OSXSAVE + XCR0)
+*/
+CDLISSwap::Level CDLISSwap::Detect()
+{
+    unsigned int  regs[4] = { 0 };
+    unsigned int  max_leaf;
+    Level         level = LEVEL_SCALAR;
+
+#if defined(_MSC_VER)
+    __cpuid((int *)regs, 0);
+    max_leaf = regs[0];
+    __cpuid((int *)regs, 1);
+#else
+    max_leaf = __get_cpuid_max(0, NULL);
+    __cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+    if (regs[2] & (1 << 9))
+        level = LEVEL_SSSE3;
+
+    // AVX2 требует OSXSAVE и включенных XMM/YMM в XCR0
+    if (level == LEVEL_SSSE3 && max_leaf >= 7 && (regs[2] & (1 << 27)))
+    {
+        unsigned long long xcr0;
+
+#if defined(_MSC_VER)
+        xcr0 = _xgetbv(0);
+        __cpuidex((int *)regs, 7, 0);
+#else
+        unsigned int lo, hi;
+        __asm__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        xcr0 = ((unsigned long long)hi << 32) | lo;
+        __cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+        if ((xcr0 & 0x6) == 0x6 && (regs[1] & (1 << 5)))
+            level = LEVEL_AVX2;
+    }
+
+    return level;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "stddef.h"
+#include "string.h"
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#define DLIS_BSWAP16(x)   _byteswap_ushort(x)
+#define DLIS_BSWAP32(x)   _byteswap_ulong(x)
+#define DLIS_BSWAP64(x)   _byteswap_uint64(x)
+#else
+#define DLIS_BSWAP16(x)   __builtin_bswap16(x)
+#define DLIS_BSWAP32(x)   __builtin_bswap32(x)
+#define DLIS_BSWAP64(x)   __builtin_bswap64(x)
+#endif
+
+// пакетное преобразование big endian -> little endian для значений фиксированной длины (2, 4, 8 байт):
+// SSSE3/AVX2 (pshufb) с выбором реализации при запуске по cpuid, на остальных процессорах - скалярный вариант
+class CDLISSwap
+{
+public:
+    enum Level
+    {
+        LEVEL_SCALAR = 0,
+        LEVEL_SSSE3  = 1,
+        LEVEL_AVX2   = 2,
+    };
+
+    // count значений размером size, лежащих подряд (весь блок кадров с одинаковыми каналами)
+    static void     Swap(void *data, size_t size, size_t count);
+    // count значений размером size с шагом stride байт (столбец канала в блоке кадров),
+    // векторный вариант только при stride == size
+    static void     SwapStrided(void *data, size_t size, size_t stride, size_t count);
+
+    static Level    GetLevel();
+
+private:
+    static Level    Detect();
+
+    static void     SwapScalar(unsigned char *data, size_t size, size_t stride, size_t count);
+    static size_t   SwapSSSE3(unsigned char *data, size_t size, size_t count);
+    static size_t   SwapAVX2(unsigned char *data, size_t size, size_t count);
+
+    static Level    s_level;
+};
+
+// разворот одного значения, длина известна при компиляции (1 байт - ничего не делаем)
+template <int size> struct CDLISSwapValue
+{
+    static void Swap(void *data) {}
+};
+
+template <> struct CDLISSwapValue<2>
+{
+    static void Swap(void *data)
+    {
+        unsigned short v;
+        memcpy(&v, data, sizeof(v));
+        v = DLIS_BSWAP16(v);
+        memcpy(data, &v, sizeof(v));
+    }
+};
+
+template <> struct CDLISSwapValue<4>
+{
+    static void Swap(void *data)
+    {
+        unsigned int v;
+        memcpy(&v, data, sizeof(v));
+        v = DLIS_BSWAP32(v);
+        memcpy(data, &v, sizeof(v));
+    }
+};
+
+template <> struct CDLISSwapValue<8>
+{
+    static void Swap(void *data)
+    {
+        unsigned long long v;
+        memcpy(&v, data, sizeof(v));
+        v = DLIS_BSWAP64(v);
+        memcpy(data, &v, sizeof(v));
+    }
+};
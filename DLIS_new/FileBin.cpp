@@ -1,7 +1,7 @@
 #include "FileBin.h"
 #include "windows.h"
 
-CFileBin::CFileBin() : m_file(INVALID_HANDLE_VALUE), m_count(0), m_test_mode(false), m_print_mode(false)
+CFileBin::CFileBin() : m_offset(0), m_count(0), m_test_mode(false), m_print_mode(false)
 {
 }
 
@@ -21,8 +21,7 @@ bool CFileBin::OpenRead(const char *file_name)
 
     Close();
 
-    m_file = CreateFile(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (m_file == INVALID_HANDLE_VALUE)
+    if (!m_file.Open(file_name, CDLISFile::FILE_READ | CDLISFile::FILE_SEQUENTIAL))
         return false;
         
     return true;
@@ -39,8 +38,7 @@ bool CFileBin::OpenWrite(const char *file_name)
 
     Close();
 
-    m_file = CreateFile(file_name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-    if (m_file == INVALID_HANDLE_VALUE)
+    if (!m_file.Open(file_name, CDLISFile::FILE_READ | CDLISFile::FILE_WRITE))
         return false;
         
     return true;
@@ -73,11 +71,10 @@ bool CFileBin::IsPrintMode()
 
 bool CFileBin::Close()
 {
-    if (m_file != INVALID_HANDLE_VALUE)
-        CloseHandle(m_file);
+    m_file.Close();
 
-    m_file  = INVALID_HANDLE_VALUE;
-    m_count = 0;
+    m_offset = 0;
+    m_count  = 0;
 
     return true;
 }
@@ -85,25 +82,16 @@ bool CFileBin::Close()
 
 bool CFileBin::Read(void *data, DWORD *len)
 {
-    BOOL  r;
-    DWORD readed = 0;
+    size_t readed = 0;
 
-    r = ReadFile(m_file, data, *len, &readed, NULL);
-    if (r == FALSE)
+    if (!m_file.ReadAt(m_offset, data, *len, &readed))
         return false;
     
+    // конец файла
     if (readed != *len)
-    {
-        if (GetLastError() == ERROR_SUCCESS)
-        {
-            *len = readed;
-        }
-        else
-        {
-            return false;
-        }
-    }
+        *len = (DWORD)readed;
     
+    m_offset += readed;
     m_count ++;
     return true;
 }
@@ -111,17 +99,10 @@ bool CFileBin::Read(void *data, DWORD *len)
 
 bool CFileBin::Write(void *data, DWORD len)
 {
-    BOOL    r;
-    DWORD   writed = 0;
-
-    r = WriteFile(m_file, data, len, &writed, NULL);
-    
-    if (r == FALSE)
-        return false;
-    
-    if (writed != len)
+    if (!m_file.WriteAt(m_offset, data, len))
         return false;
     
+    m_offset += len;
     m_count ++;
     return true;
 }
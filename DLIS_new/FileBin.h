@@ -1,11 +1,13 @@
 #pragma once
 
 #include "windows.h"
+#include "DlisFile.h"
 
 class CFileBin
 {
 private:
-    HANDLE      m_file;
+    CDLISFile   m_file;
+    UINT64      m_offset;
     size_t      m_count;
 
     bool        m_test_mode; 
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdio.h>
+
+// минимальная проверка для тестов: ошибка печатается с местом в исходнике и
+// увеличивает счетчик ошибок набора, выполнение набора продолжается
+extern int g_test_failures;
+
+#define DLIS_CHECK(expr)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(expr))                                                            \
+        {                                                                       \
+            printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #expr);    \
+            g_test_failures++;                                                  \
+        }                                                                       \
+    }                                                                           \
+    while (0)
+
+// наборы тестов
+void TestConvert();
+void TestFrame();
+void TestParser();
+void TestPipeline();
+void TestLarge();
+void TestIndex();
+void TestBatch();
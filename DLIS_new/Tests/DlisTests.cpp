@@ -0,0 +1,40 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+
+int g_test_failures = 0;
+
+struct TestSuite
+{
+    const char  *name;
+    void       (*func)();
+};
+
+static TestSuite s_suites[] =
+{
+    { "convert",  TestConvert },
+    { "frame",    TestFrame },
+    { "parser",   TestParser },
+    { "pipeline", TestPipeline },
+    { "large",    TestLarge },
+    { "index",    TestIndex },
+    { "batch",    TestBatch },
+};
+
+
+int main(int argc, char **argv)
+{
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(s_suites) / sizeof(s_suites[0]); i++)
+    {
+        int before = g_test_failures;
+
+        s_suites[i].func();
+
+        printf("%-10s %s\n", s_suites[i].name, g_test_failures == before ? "ok" : "FAILED");
+        if (g_test_failures != before)
+            failed++;
+    }
+
+    return failed ? 1 : 0;
+}
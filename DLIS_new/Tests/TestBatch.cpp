@@ -0,0 +1,107 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DlisBatch.h"
+#include "TestFile.h"
+
+#include <stdio.h>
+
+enum
+{
+    BATCH_FILES   = 3,
+    BATCH_VALUES  = 1000,                       // байт значений кадра: пакет 1 Мб - около тысячи кадров
+};
+
+static const char    *s_batch_files[BATCH_FILES] = { "TestBatch1.dlis", "TestBatch2.dlis", "TestBatch3.dlis" };
+static const wchar_t *s_batch_names[BATCH_FILES] = { L"TestBatch1.dlis", L"TestBatch2.dlis", L"TestBatch3.dlis" };
+static const int      s_batch_rows[BATCH_FILES]  = { 1500, 3500, 2500 };
+
+/*
+*  фрейм MAIN с одним каналом DATA (USHORT[BATCH_VALUES]), кадры с номерами 1..rows,
+*  в каждом файле несколько пакетов по BATCH_BYTES
+*/
+static bool BuildBatchFile(const char *path, int rows)
+{
+    static const TestChannel channels[] = { { "DATA", RC_USHORT, BATCH_VALUES } };
+
+    CTestFile  file;
+    TestBytes  values(BATCH_VALUES, 0x5A);
+
+    file.FileHeader(1);
+    file.Channels(channels, 1);
+    file.Frame("MAIN", channels, 1);
+
+    for (int row = 1; row <= rows; row++)
+        file.Row("MAIN", row, values);
+
+    return file.Write(path);
+}
+
+
+struct BatchFileResult
+{
+    int  rows;
+    int  last;
+    int  bad;
+};
+
+/*
+*  callback одного файла вызываются по очереди, разные файлы - параллельно: у каждого файла свой счетчик
+*/
+static void BatchNotify(int file, CDLISFrame *frame, void *params)
+{
+    BatchFileResult *result = (BatchFileResult *)params + file;
+
+    for (int row = 0; row < frame->CountRows(); row++, result->rows++)
+    {
+        int number = frame->GetNumber(row);
+
+        if (number != result->last + 1)
+            result->bad++;
+        result->last = number;
+    }
+}
+
+/*
+*  кадры каждого файла приходят в порядке файла при любом бюджете памяти: и когда пакеты
+*  преобразуются задачами других потоков, и когда бюджет исчерпан и пакет преобразуется
+*  в потоке разбора, дожидаясь очереди на callback
+*/
+static void CheckBatchOrder(int threads, size_t budget)
+{
+    CDLISBatch       batch;
+    BatchFileResult  results[BATCH_FILES] = {};
+
+    for (int i = 0; i < BATCH_FILES; i++)
+        DLIS_CHECK(batch.AddFile(s_batch_names[i]));
+
+    batch.SetMemoryBudget(budget);
+    DLIS_CHECK(batch.Run(threads, BatchNotify, results));
+
+    for (int i = 0; i < BATCH_FILES; i++)
+    {
+        DLIS_CHECK(batch.GetResult(i));
+        DLIS_CHECK(results[i].rows == s_batch_rows[i]);
+        DLIS_CHECK(results[i].last == s_batch_rows[i]);
+        DLIS_CHECK(results[i].bad == 0);
+    }
+}
+
+
+void TestBatch()
+{
+    for (int i = 0; i < BATCH_FILES; i++)
+        DLIS_CHECK(BuildBatchFile(s_batch_files[i], s_batch_rows[i]));
+
+    // бюджет меньше одного пакета - все пакеты преобразуются в потоке разбора
+    CheckBatchOrder(4, 1);
+    // один поток и место на один пакет: первый пакет ждет в очереди, следующий преобразуется
+    // на месте и должен дождаться, пока поток сам выполнит задачу первого
+    CheckBatchOrder(1, CDLISBatch::FILE_CHUNK + CDLISBatch::BATCH_BYTES + 2 * BATCH_VALUES);
+    // буферы чтения и пара пакетов - часть пакетов уходит задачами, часть преобразуется на месте
+    CheckBatchOrder(4, BATCH_FILES * CDLISBatch::FILE_CHUNK + 2 * CDLISBatch::BATCH_BYTES);
+    // по умолчанию
+    CheckBatchOrder(4, 0);
+
+    for (int i = 0; i < BATCH_FILES; i++)
+        remove(s_batch_files[i]);
+}
@@ -0,0 +1,123 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DlisConvert.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+// значения в том виде, в каком они лежат в памяти после разворота из big endian
+struct ConvertCase
+{
+    unsigned int  raw;
+    float         value;
+};
+
+// IBM: 0x42640000 = 100.0, 0x41100000 = 1.0, 0x40800000 = 0.5
+static const ConvertCase s_ibm[] =
+{
+    { 0x42640000, 100.0f }, { 0xC2640000, -100.0f }, { 0x41100000, 1.0f }, { 0x40800000, 0.5f },
+    { 0x00000000, 0.0f },   { 0x41200000, 2.0f },    { 0xC1100000, -1.0f }, { 0x42100000, 16.0f },
+};
+
+// VAX F: байты файла 80 40 00 00 = 1.0, 00 41 00 00 = 2.0, 00 40 00 00 = 0.5
+static const ConvertCase s_vax[] =
+{
+    { 0x80400000, 1.0f },   { 0x80C00000, -1.0f },   { 0x00410000, 2.0f },  { 0x00400000, 0.5f },
+    { 0x00000000, 0.0f },   { 0x00C10000, -2.0f },   { 0x80410000, 4.0f },  { 0xC8430000, 100.0f },
+};
+
+// FSHORT: 0x4001 = 1.0, 0x4002 = 2.0, 0xC001 = -1.0
+static const struct { unsigned short raw; float value; } s_fshort[] =
+{
+    { 0x4001, 1.0f }, { 0x4002, 2.0f }, { 0xC001, -1.0f }, { 0x0000, 0.0f }, { 0x4000, 0.5f },
+};
+
+enum { CASES = sizeof(s_ibm) / sizeof(s_ibm[0]) };
+
+/*
+*  шаг 4 байта - четверки идут через SSE2, шаг 8 байт - только поэлементно
+*/
+static void CheckBlock(const ConvertCase *cases, void (*convert)(void *, size_t, size_t))
+{
+    unsigned int   packed[CASES];
+    unsigned int   strided[CASES * 2];
+    float          f;
+
+    for (int i = 0; i < CASES; i++)
+    {
+        packed[i]          = cases[i].raw;
+        strided[i * 2]     = cases[i].raw;
+        strided[i * 2 + 1] = 0xDEADBEEF;
+    }
+
+    convert(packed, sizeof(unsigned int), CASES);
+    convert(strided, 2 * sizeof(unsigned int), CASES);
+
+    for (int i = 0; i < CASES; i++)
+    {
+        memcpy(&f, &packed[i], sizeof(f));
+        DLIS_CHECK(f == cases[i].value);
+
+        memcpy(&f, &strided[i * 2], sizeof(f));
+        DLIS_CHECK(f == cases[i].value);
+        DLIS_CHECK(strided[i * 2 + 1] == 0xDEADBEEF);
+    }
+}
+
+/*
+*  блочное преобразование (SSE2 с откатом на поэлементное) совпадает с поэлементным побитно
+*/
+static void CheckRandom(float (*value)(unsigned int), void (*convert)(void *, size_t, size_t))
+{
+    enum { COUNT = 4096 + 3 };
+
+    static unsigned int data[COUNT];
+    unsigned int        source[COUNT];
+
+    srand(12345);
+    for (int i = 0; i < COUNT; i++)
+    {
+        source[i] = ((unsigned int)rand() << 17) ^ ((unsigned int)rand() << 5) ^ (unsigned int)rand();
+        data[i]   = source[i];
+    }
+
+    convert(data, sizeof(unsigned int), COUNT);
+
+    int bad = 0;
+    for (int i = 0; i < COUNT; i++)
+    {
+        float expected = value(source[i]);
+
+        if (memcmp(&expected, &data[i], sizeof(float)) != 0)
+            bad++;
+    }
+    DLIS_CHECK(bad == 0);
+}
+
+
+void TestConvert()
+{
+    for (int i = 0; i < CASES; i++)
+    {
+        DLIS_CHECK(CDLISConvert::IbmValue(s_ibm[i].raw) == s_ibm[i].value);
+        DLIS_CHECK(CDLISConvert::VaxValue(s_vax[i].raw) == s_vax[i].value);
+    }
+
+    CheckBlock(s_ibm, CDLISConvert::IbmToFloat);
+    CheckBlock(s_vax, CDLISConvert::VaxToFloat);
+
+    CheckRandom(CDLISConvert::IbmValue, CDLISConvert::IbmToFloat);
+    CheckRandom(CDLISConvert::VaxValue, CDLISConvert::VaxToFloat);
+
+    unsigned short  raw[2] = { 0, 0 };
+    float           dst[1];
+
+    for (size_t i = 0; i < sizeof(s_fshort) / sizeof(s_fshort[0]); i++)
+    {
+        DLIS_CHECK(CDLISConvert::FshortValue(s_fshort[i].raw) == s_fshort[i].value);
+
+        raw[1] = s_fshort[i].raw;
+        CDLISConvert::FshortToFloat(&raw[1], sizeof(unsigned short), dst, 1);
+        DLIS_CHECK(dst[0] == s_fshort[i].value);
+    }
+}
@@ -0,0 +1,231 @@
+#include "StdAfx.h"
+#include "TestFile.h"
+#include "DlisCommon.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+void TestPutBytes(TestBytes *dst, const void *data, size_t len)
+{
+    dst->insert(dst->end(), (const unsigned char *)data, (const unsigned char *)data + len);
+}
+
+
+void TestPutIdent(TestBytes *dst, const char *text)
+{
+    dst->push_back((unsigned char)strlen(text));
+    TestPutBytes(dst, text, strlen(text));
+}
+
+
+void TestPutObname(TestBytes *dst, const char *text)
+{
+    dst->push_back(1);      // origin
+    dst->push_back(0);      // copy
+    TestPutIdent(dst, text);
+}
+
+
+void TestPutUvari(TestBytes *dst, unsigned int value)
+{
+    if (value < 0x80)
+    {
+        dst->push_back((unsigned char)value);
+    }
+    else if (value < 0x4000)
+    {
+        dst->push_back((unsigned char)(0x80 | (value >> 8)));
+        dst->push_back((unsigned char)value);
+    }
+    else
+    {
+        dst->push_back((unsigned char)(0xC0 | (value >> 24)));
+        dst->push_back((unsigned char)(value >> 16));
+        dst->push_back((unsigned char)(value >> 8));
+        dst->push_back((unsigned char)value);
+    }
+}
+
+
+void TestPutFloat(TestBytes *dst, float value)
+{
+    unsigned int bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 3; i >= 0; i--)
+        dst->push_back((unsigned char)(bits >> (i * 8)));
+}
+
+
+void TestPutDouble(TestBytes *dst, double value)
+{
+    unsigned long long bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 7; i >= 0; i--)
+        dst->push_back((unsigned char)(bits >> (i * 8)));
+}
+
+
+void TestPutIbm(TestBytes *dst, int value)
+{
+    dst->push_back(0x42);
+    dst->push_back((unsigned char)value);
+    dst->push_back(0);
+    dst->push_back(0);
+}
+
+
+CTestFile::CTestFile(size_t record_limit) : m_record_limit(record_limit)
+{
+    char label[81];
+
+    sprintf(label, "%-4s%-5s%-6s%-5s%-60s", "   1", "V1.00", "RECORD", " 8192", "TEST");
+    TestPutBytes(&data, label, 80);
+}
+
+
+void CTestFile::FileHeader(int sequence)
+{
+    TestBytes body;
+    char      text[16];
+
+    Flush();
+
+    sprintf(text, "%d", sequence);
+
+    body.push_back(0xF0);
+    TestPutIdent(&body, "FILE-HEADER");
+    body.push_back(0x34);
+    TestPutIdent(&body, "SEQUENCE-NUMBER");
+    body.push_back(RC_ASCII);
+    body.push_back(0x70);
+    TestPutObname(&body, "0");
+    body.push_back(0x21);
+    TestPutUvari(&body, (unsigned int)strlen(text));
+    TestPutBytes(&body, text, strlen(text));
+    Segment(body, true, 0);
+}
+
+/*
+*  шаблон REPRESENTATION-CODE (USHORT) и DIMENSION (UVARI), у каждого канала оба значения
+*/
+void CTestFile::Channels(const TestChannel *channels, int count)
+{
+    TestBytes body;
+
+    body.push_back(0xF0);
+    TestPutIdent(&body, "CHANNEL");
+    body.push_back(0x34);
+    TestPutIdent(&body, "REPRESENTATION-CODE");
+    body.push_back(RC_USHORT);
+    body.push_back(0x34);
+    TestPutIdent(&body, "DIMENSION");
+    body.push_back(RC_UVARI);
+    for (int i = 0; i < count; i++)
+    {
+        body.push_back(0x70);
+        TestPutObname(&body, channels[i].name);
+        body.push_back(0x21);
+        body.push_back(channels[i].code);
+        body.push_back(0x21);
+        TestPutUvari(&body, (unsigned int)channels[i].dimension);
+    }
+    Segment(body, true, 3);
+}
+
+
+void CTestFile::Frame(const char *name, const TestChannel *channels, int count)
+{
+    TestFrameInfo frame = { name, channels, count };
+
+    Frames(&frame, 1);
+}
+
+/*
+*  шаблон CHANNELS (OBNAME), у объекта фрейма - все его каналы
+*/
+void CTestFile::Frames(const TestFrameInfo *frames, int count)
+{
+    TestBytes body;
+
+    body.push_back(0xF0);
+    TestPutIdent(&body, "FRAME");
+    body.push_back(0x34);
+    TestPutIdent(&body, "CHANNELS");
+    body.push_back(RC_OBNAME);
+    for (int i = 0; i < count; i++)
+    {
+        body.push_back(0x70);
+        TestPutObname(&body, frames[i].name);
+        body.push_back(0x29);
+        TestPutUvari(&body, (unsigned int)frames[i].count);
+        for (int k = 0; k < frames[i].count; k++)
+            TestPutObname(&body, frames[i].channels[k].name);
+    }
+    Segment(body, true, 4);
+}
+
+
+void CTestFile::Row(const char *frame, unsigned int number, const TestBytes &values)
+{
+    TestBytes body;
+
+    TestPutObname(&body, frame);
+    TestPutUvari(&body, number);
+    TestPutBytes(&body, &values[0], values.size());
+    Segment(body, false, 0);
+}
+
+
+void CTestFile::Segment(const TestBytes &body, bool eflr, unsigned char type)
+{
+    size_t len = body.size() + 4;
+    bool   pad = (len % 2) != 0;
+
+    len += pad ? 1 : 0;
+    if (!m_record.empty() && m_record.size() + len > m_record_limit)
+        Flush();
+
+    m_record.push_back((unsigned char)(len >> 8));
+    m_record.push_back((unsigned char)len);
+    m_record.push_back((unsigned char)((eflr ? 0x80 : 0) | (pad ? 0x01 : 0)));
+    m_record.push_back(type);
+    TestPutBytes(&m_record, &body[0], body.size());
+    if (pad)
+        m_record.push_back(1);
+}
+
+
+void CTestFile::Flush()
+{
+    if (m_record.empty())
+        return;
+
+    data.push_back((unsigned char)((m_record.size() + 4) >> 8));
+    data.push_back((unsigned char)(m_record.size() + 4));
+    data.push_back(0xFF);
+    data.push_back(1);
+    TestPutBytes(&data, &m_record[0], m_record.size());
+
+    m_record.clear();
+}
+
+
+bool CTestFile::Write(const char *path)
+{
+    FILE   *out;
+    bool    r;
+
+    Flush();
+
+    out = fopen(path, "wb");
+    if (!out)
+        return false;
+
+    r = fwrite(&data[0], 1, data.size(), out) == data.size();
+    fclose(out);
+
+    return r;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+
+typedef std::vector<unsigned char> TestBytes;
+
+// канал синтетического файла: имя, код представления и число значений
+struct TestChannel
+{
+    const char     *name;
+    unsigned char   code;
+    int             dimension;
+};
+
+// фрейм синтетического файла: имя и его каналы
+struct TestFrameInfo
+{
+    const char         *name;
+    const TestChannel  *channels;
+    int                 count;
+};
+
+// значения в байтах файла (big endian)
+void TestPutBytes(TestBytes *dst, const void *data, size_t len);
+void TestPutIdent(TestBytes *dst, const char *text);
+void TestPutObname(TestBytes *dst, const char *text);
+void TestPutUvari(TestBytes *dst, unsigned int value);
+void TestPutFloat(TestBytes *dst, float value);
+void TestPutDouble(TestBytes *dst, double value);
+// положительное целое меньше 256 в IBM single: 16^2 * 0.xx
+void TestPutIbm(TestBytes *dst, int value);
+
+/*
+*  сборка синтетического файла DLIS в памяти: метка тома, затем сегменты, которые копятся
+*  в текущей visible record (не длиннее record_limit байт)
+*/
+class CTestFile
+{
+public:
+    TestBytes       data;
+
+private:
+    TestBytes       m_record;
+    size_t          m_record_limit;
+
+public:
+    CTestFile(size_t record_limit = 8000);
+
+    // FILE-HEADER начинает логический файл с новой visible record
+    void            FileHeader(int sequence);
+    // набор CHANNEL и набор FRAME из одного фрейма name со всеми каналами
+    void            Channels(const TestChannel *channels, int count);
+    void            Frame(const char *name, const TestChannel *channels, int count);
+    // набор FRAME из нескольких фреймов (парсер ищет фреймы только в первом наборе FRAME)
+    void            Frames(const TestFrameInfo *frames, int count);
+    // кадр: имя фрейма, номер и values - значения каналов в байтах файла
+    void            Row(const char *frame, unsigned int number, const TestBytes &values);
+
+    void            Segment(const TestBytes &body, bool eflr, unsigned char type);
+    // закрывает текущую visible record
+    void            Flush();
+
+    bool            Write(const char *path);
+};
@@ -0,0 +1,69 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DLISFrame.h"
+
+#include <string.h>
+
+enum { FRAME_ROWS = 5, FRAME_LEN = 12 };
+
+// строка кадра в байтах файла: FSINGL 100.0, ISINGL 100.0, VSINGL 1.0
+static const unsigned char s_mixed_row[FRAME_LEN] =
+{
+    0x42, 0xC8, 0x00, 0x00,  0x42, 0x64, 0x00, 0x00,  0x80, 0x40, 0x00, 0x00,
+};
+
+static void FillMixed(CDLISFrame *frame, DlisValueObjName *name, DlisChannelInfo *channels)
+{
+    static const RepresentationCodes codes[] = { RC_FSINGL, RC_ISINGL, RC_VSINGL };
+
+    memset(name, 0, sizeof(*name));
+    memset(channels, 0, 3 * sizeof(*channels));
+    for (int i = 0; i < 3; i++)
+    {
+        channels[i].code         = codes[i];
+        channels[i].dimension    = 1;
+        channels[i].element_size = sizeof(float);
+        channels[i].offsets      = i * (int)sizeof(float);
+    }
+
+    frame->Initialize();
+    frame->AddChannels(name, channels, 3, FRAME_LEN, false);
+    for (int row = 0; row < FRAME_ROWS; row++)
+        memcpy(frame->AddRow(row), s_mixed_row, FRAME_LEN);
+}
+
+/*
+*  каналы разных кодов одной длины: блочный Decode и преобразование
+*  по столбцам при обращении должны давать одни и те же IEEE значения
+*/
+static void CheckMixedCodes(bool block)
+{
+    static const float expected[] = { 100.0f, 100.0f, 1.0f };
+
+    CDLISFrame        frame;
+    DlisValueObjName  name;
+    DlisChannelInfo   channels[3];
+    int               dimension;
+    float            *value;
+
+    FillMixed(&frame, &name, channels);
+    if (block)
+        frame.Decode();
+
+    for (int row = 0; row < FRAME_ROWS; row++)
+        for (int column = 0; column < 3; column++)
+        {
+            value = frame.GetValueFloat(column, row, &dimension);
+            DLIS_CHECK(value != NULL && dimension == 1);
+            DLIS_CHECK(value != NULL && *value == expected[column]);
+        }
+
+    frame.Shutdown();
+}
+
+
+void TestFrame()
+{
+    CheckMixedCodes(true);
+    CheckMixedCodes(false);
+}
@@ -0,0 +1,238 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DLISParser.h"
+#include "TestFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/utime.h>
+
+enum { INDEX_ROWS = 60 };
+
+static const char    *s_index_file = "TestIndex.dlis";
+static const wchar_t *s_index_name = L"TestIndex.dlis";
+static const wchar_t *s_index_idx  = L"TestIndex.dlis.idx";
+
+/*
+*  фрейм MAIN: DEPT (FDOUBL, индексный канал) и AMP (FSINGL); за каждым кадром MAIN - кадр фрейма AUX,
+*  поэтому записи MAIN не сливаются в одну серию и в индексе их INDEX_ROWS.
+*  DEPT в строке i: 100 + i / 2 или 100 - i / 2 (убывающий индекс), AMP = i
+*/
+static void BuildIndexFile(CTestFile *file, bool decreasing, int rows)
+{
+    static const TestChannel channels[] =
+    {
+        { "DEPT", RC_FDOUBL, 1 }, { "AMP", RC_FSINGL, 1 },
+    };
+
+    static const TestFrameInfo frames[] =
+    {
+        { "MAIN", channels, 2 }, { "AUX", channels + 1, 1 },
+    };
+
+    file->FileHeader(1);
+    file->Channels(channels, 2);
+    file->Frames(frames, 2);
+
+    for (int row = 1; row <= rows; row++)
+    {
+        TestBytes main, aux;
+
+        TestPutDouble(&main, decreasing ? 100.0 - row / 2.0 : 100.0 + row / 2.0);
+        TestPutFloat(&main, (float)row);
+        file->Row("MAIN", row, main);
+
+        TestPutFloat(&aux, (float)row);
+        file->Row("AUX", row, aux);
+    }
+
+    file->Flush();
+}
+
+
+static DlisObject *FrameFind(CDLISParser *parser, const char *name)
+{
+    DlisSet *root = parser->GetRoot();
+
+    for (DlisSet *set = root ? root->childs : NULL; set; set = set->next)
+    {
+        if (strcmp(set->type, "FRAME") != 0)
+            continue;
+
+        for (DlisObject *object = set->objects; object; object = object->next)
+            if (strcmp(object->name.identifier, name) == 0)
+                return object;
+    }
+
+    return NULL;
+}
+
+
+static bool IndexValid()
+{
+    CDLISIndex  index;
+    CDLISFile   source;
+
+    if (!source.Open(s_index_name, CDLISFile::FILE_READ))
+        return false;
+
+    return index.Load(s_index_idx, &source);
+}
+
+/*
+*  первое открытие строит и сохраняет индекс, второе читает его: записи и фреймы те же,
+*  кадры по номерам совпадают
+*/
+static void CheckIndexRoundTrip()
+{
+    CTestFile    file;
+    CDLISIndex   index;
+    CDLISFile    source;
+    int          rows[2] = { 0, 0 };
+
+    BuildIndexFile(&file, false, INDEX_ROWS);
+    DLIS_CHECK(file.Write(s_index_file));
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        CDLISParser  parser;
+        CDLISFrame   frame;
+        int          dimension;
+
+        DLIS_CHECK(parser.Initialize());
+        DLIS_CHECK(parser.Open(s_index_name));
+        DLIS_CHECK(parser.ReadFrames(FrameFind(&parser, "MAIN"), 10, 20, &frame));
+
+        rows[pass] = frame.CountRows();
+        for (int row = 0; row < frame.CountRows(); row++)
+        {
+            float *amp = frame.GetValueFloat(1, row, &dimension);
+
+            DLIS_CHECK(frame.GetNumber(row) == row + 10);
+            DLIS_CHECK(amp && *amp == (float)(row + 10));
+        }
+
+        frame.Shutdown();
+        parser.Shutdown();
+    }
+
+    DLIS_CHECK(rows[0] == 10 && rows[1] == 10);
+
+    DLIS_CHECK(source.Open(s_index_name, CDLISFile::FILE_READ));
+    DLIS_CHECK(index.Load(s_index_idx, &source));
+    DLIS_CHECK(index.FrameCount() == 2 && strcmp(index.FrameName(0), "MAIN") == 0);
+
+    size_t main_records = 0;
+    for (size_t i = 0; i < index.RecordCount(); i++)
+        if (index.RecordGet(i)->frame == 0)
+            main_records++;
+    DLIS_CHECK(main_records == INDEX_ROWS);
+}
+
+/*
+*  индекс устарел: у файла другое время записи или другой размер. Load его отвергает,
+*  Open строит заново
+*/
+static void CheckIndexStale()
+{
+    CTestFile       file;
+    struct _utimbuf times;
+
+    BuildIndexFile(&file, false, INDEX_ROWS);
+    DLIS_CHECK(file.Write(s_index_file));
+
+    {
+        CDLISParser parser;
+
+        DLIS_CHECK(parser.Initialize());
+        DLIS_CHECK(parser.Open(s_index_name));
+        parser.Shutdown();
+    }
+    DLIS_CHECK(IndexValid());
+
+    // те же байты, другое время записи
+    times.actime  = 1000000000;
+    times.modtime = 1000000000;
+    DLIS_CHECK(_utime(s_index_file, &times) == 0);
+    DLIS_CHECK(!IndexValid());
+
+    {
+        CDLISParser parser;
+
+        DLIS_CHECK(parser.Initialize());
+        DLIS_CHECK(parser.Open(s_index_name));
+        parser.Shutdown();
+    }
+    DLIS_CHECK(IndexValid());
+
+    // файл дописан
+    CTestFile longer;
+
+    BuildIndexFile(&longer, false, INDEX_ROWS + 1);
+    DLIS_CHECK(longer.Write(s_index_file));
+    DLIS_CHECK(!IndexValid());
+}
+
+/*
+*  выборка по интервалу индексного канала на возрастающем и убывающем индексе:
+*  бинарный поиск серий не должен терять кадры ни с одного края интервала
+*/
+static void CheckIndexSearch(bool decreasing)
+{
+    CTestFile    file;
+    CDLISParser  parser;
+    DlisObject  *frame_obj;
+    double       sign = decreasing ? -1.0 : 1.0;
+
+    // интервалы в номерах кадров [first, last]
+    static const int ranges[][2] = { { 20, 30 }, { 1, 1 }, { INDEX_ROWS, INDEX_ROWS }, { 1, INDEX_ROWS }, { 7, 8 } };
+
+    BuildIndexFile(&file, decreasing, INDEX_ROWS);
+    DLIS_CHECK(file.Write(s_index_file));
+
+    DLIS_CHECK(parser.Initialize());
+    DLIS_CHECK(parser.Open(s_index_name));
+
+    frame_obj = FrameFind(&parser, "MAIN");
+    DLIS_CHECK(frame_obj != NULL);
+
+    for (size_t i = 0; frame_obj && i < sizeof(ranges) / sizeof(ranges[0]); i++)
+    {
+        CDLISFrame  frame;
+        int         first = ranges[i][0], last = ranges[i][1];
+        double      from  = 100.0 + sign * first / 2.0;
+        double      to    = 100.0 + sign * last / 2.0;
+
+        // границы интервала в любом порядке
+        DLIS_CHECK(parser.ReadFramesByIndex(frame_obj, i % 2 ? to : from, i % 2 ? from : to, &frame));
+
+        DLIS_CHECK(frame.CountRows() == last - first + 1);
+        for (int row = 0; row < frame.CountRows(); row++)
+            DLIS_CHECK(frame.GetNumber(row) == first + row);
+
+        frame.Shutdown();
+    }
+
+    // интервал вне значений индекса
+    {
+        CDLISFrame frame;
+
+        DLIS_CHECK(parser.ReadFramesByIndex(frame_obj, 1000.0, 2000.0, &frame));
+        DLIS_CHECK(frame.CountRows() == 0);
+        frame.Shutdown();
+    }
+
+    parser.Shutdown();
+}
+
+
+void TestIndex()
+{
+    CheckIndexRoundTrip();
+    CheckIndexStale();
+    CheckIndexSearch(false);
+    CheckIndexSearch(true);
+
+    remove(s_index_file);
+    remove("TestIndex.dlis.idx");
+}
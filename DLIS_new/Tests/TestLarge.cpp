@@ -0,0 +1,234 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DLISParser.h"
+#include "TestFile.h"
+
+#include <string.h>
+
+/*
+*  синтетический источник больше 4 Гб: visible record создаются при чтении, на диске ничего нет.
+*  Два логических файла, второй начинается чуть раньше 2^32 и пересекает эту границу:
+*  [метка, EFLR 1][тело 1: m_records1 записей][EFLR 2][тело 2: m_records2 записей]
+*  В записи тела два кадра фрейма MAIN, номера кадров в логическом файле идут с 1
+*/
+class CLargeSource : public CDLISSource
+{
+public:
+    enum
+    {
+        DATA_LEN    = 8177,                         // USHORT значения кадра, сегмент ровно 8192 байт
+        SEGMENT_LEN = 8192,
+        ROWS        = 2,                            // кадров в записи тела
+        RECORD_LEN  = 4 + ROWS * SEGMENT_LEN,
+        NUMBER_POS  = 4 + 4 + 7,                    // UVARI номера: заголовки записи и сегмента, OBNAME
+    };
+
+    TestBytes       m_head1;
+    TestBytes       m_head2;
+    TestBytes       m_body;
+
+    UINT64          m_records1;
+    UINT64          m_records2;
+    UINT64          m_begin2;
+    UINT64          m_size;
+    UINT64          m_offset;
+
+    // последняя собранная запись тела
+    int             m_cached_file;
+    UINT64          m_cached_index;
+    TestBytes       m_record;
+
+public:
+    CLargeSource(UINT64 tail) : m_offset(0), m_cached_file(-1), m_cached_index(0)
+    {
+        static const TestChannel channels[] = { { "DATA", RC_USHORT, DATA_LEN } };
+
+        CTestFile   head1, head2, body(RECORD_LEN);
+        TestBytes   values(DATA_LEN, 0x5A);
+
+        head1.FileHeader(1);
+        head1.Channels(channels, 1);
+        head1.Frame("MAIN", channels, 1);
+        head1.Flush();
+        m_head1 = head1.data;
+
+        head2.FileHeader(2);
+        head2.Channels(channels, 1);
+        head2.Frame("MAIN", channels, 1);
+        head2.Flush();
+        m_head2.assign(head2.data.begin() + 80, head2.data.end());
+
+        // номер 0x4000 и больше - UVARI из четырех байт, дальше он только подменяется
+        for (int i = 0; i < ROWS; i++)
+            body.Row("MAIN", 0x4000, values);
+        body.Flush();
+        m_body.assign(body.data.begin() + 80, body.data.end());
+        m_record = m_body;
+
+        m_records1 = (0x100000000ULL - m_head1.size() - (1 << 20)) / RECORD_LEN;
+        m_records2 = tail / RECORD_LEN;
+        m_begin2   = m_head1.size() + m_records1 * RECORD_LEN;
+        m_size     = m_begin2 + m_head2.size() + m_records2 * RECORD_LEN;
+    }
+
+    virtual bool Read(char *data, size_t len, size_t *readed)
+    {
+        *readed = 0;
+
+        while (len && m_offset < m_size)
+        {
+            const unsigned char *src;
+            size_t               avail;
+
+            src = Piece(m_offset, &avail);
+            if (avail > len)
+                avail = len;
+
+            memcpy(data, src, avail);
+            data     += avail;
+            len      -= avail;
+            m_offset += avail;
+            *readed  += avail;
+        }
+
+        return true;
+    }
+
+    virtual bool Size(UINT64 *size)
+    {
+        *size = m_size;
+        return true;
+    }
+
+    virtual bool Seek(UINT64 offset)
+    {
+        if (offset > m_size)
+            return false;
+
+        m_offset = offset;
+        return true;
+    }
+
+private:
+    const unsigned char *Piece(UINT64 offset, size_t *avail)
+    {
+        UINT64 body2 = m_begin2 + m_head2.size();
+
+        if (offset < m_head1.size())
+        {
+            *avail = (size_t)(m_head1.size() - offset);
+            return &m_head1[(size_t)offset];
+        }
+
+        if (offset >= m_begin2 && offset < body2)
+        {
+            *avail = (size_t)(body2 - offset);
+            return &m_head2[(size_t)(offset - m_begin2)];
+        }
+
+        int     file = offset < m_begin2 ? 0 : 1;
+        UINT64  pos  = offset - (file == 0 ? m_head1.size() : body2);
+        size_t  in   = (size_t)(pos % RECORD_LEN);
+
+        Record(file, pos / RECORD_LEN);
+
+        *avail = RECORD_LEN - in;
+        return &m_record[in];
+    }
+
+    void Record(int file, UINT64 index)
+    {
+        if (m_cached_file == file && m_cached_index == index)
+            return;
+
+        m_cached_file  = file;
+        m_cached_index = index;
+
+        for (int i = 0; i < ROWS; i++)
+        {
+            unsigned int   number = (unsigned int)(index * ROWS + i + 1) | 0xC0000000;
+            unsigned char *dst    = &m_record[NUMBER_POS + i * SEGMENT_LEN];
+
+            dst[0] = (unsigned char)(number >> 24);
+            dst[1] = (unsigned char)(number >> 16);
+            dst[2] = (unsigned char)(number >> 8);
+            dst[3] = (unsigned char)number;
+        }
+    }
+};
+
+
+struct LargeResult
+{
+    UINT64  rows;
+    int     expected;
+    int     last;
+    int     bad;
+    // после стольких кадров начинается второй логический файл (номера снова с 1)
+    UINT64  restart;
+};
+
+static void LargeNotify(CDLISFrame *frame, void *params)
+{
+    LargeResult *result = (LargeResult *)params;
+
+    for (int row = 0; row < frame->CountRows(); row++, result->rows++)
+    {
+        if (result->rows == result->restart)
+            result->expected = 1;
+
+        result->last = frame->GetNumber(row);
+        if (result->last != result->expected++)
+            result->bad++;
+    }
+}
+
+/*
+*  весь файл потоком: порции чтения (BufferFill) и проверка конца (BufferIsEOF) после 2^32
+*/
+static void CheckLargeParse(CLargeSource *source)
+{
+    CDLISParser  parser;
+    LargeResult  result = { 0, 1, 0, 0, source->m_records1 * CLargeSource::ROWS };
+
+    DLIS_CHECK(source->m_size > 0x100000000ULL);
+
+    DLIS_CHECK(parser.Initialize());
+    parser.CallbackNotifyFrame(LargeNotify, &result);
+    DLIS_CHECK(parser.Parse(source));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.rows == (source->m_records1 + source->m_records2) * CLargeSource::ROWS);
+    DLIS_CHECK(result.last == (int)(source->m_records2 * CLargeSource::ROWS));
+    DLIS_CHECK(result.bad == 0);
+}
+
+/*
+*  второй логический файл: переход (BufferSeek) перед 2^32, чтение через границу до конца участка
+*/
+static void CheckLargeRange(CLargeSource *source)
+{
+    CDLISParser  parser;
+    LargeResult  result = { 0, 1, 0, 0, (UINT64)-1 };
+
+    DLIS_CHECK(source->m_begin2 < 0x100000000ULL);
+
+    DLIS_CHECK(parser.Initialize());
+    parser.CallbackNotifyFrame(LargeNotify, &result);
+    DLIS_CHECK(parser.ParseRange(source, source->m_begin2, source->m_size));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.rows == source->m_records2 * CLargeSource::ROWS);
+    DLIS_CHECK(result.last == (int)(source->m_records2 * CLargeSource::ROWS));
+    DLIS_CHECK(result.bad == 0);
+}
+
+
+void TestLarge()
+{
+    // второй логический файл - 64 Мб, из них почти все после 2^32
+    CLargeSource source(64 << 20);
+
+    CheckLargeParse(&source);
+    CheckLargeRange(&source);
+}
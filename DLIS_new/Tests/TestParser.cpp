@@ -0,0 +1,406 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DLISParser.h"
+#include "DlisFrameCursor.h"
+#include "TestFile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+enum { PARSER_ROWS = 40 };
+
+/*
+*  фрейм MAIN: TIME (FSINGL), NAME (IDENT, переменной длины), VAL (ISINGL)
+*  в строке i: TIME = i / 2, NAME - "N" и символы 'x' (длина растет с номером), VAL = i.
+*  Строки делятся поровну между logical_files логическими файлами, каждый в своей visible record;
+*  CHANNEL и FRAME описаны только в первом, остальные ссылаются на его фрейм
+*/
+static void BuildVariableFile(CTestFile *file, int logical_files)
+{
+    static const TestChannel channels[] =
+    {
+        { "TIME", RC_FSINGL, 1 }, { "NAME", RC_IDENT, 1 }, { "VAL", RC_ISINGL, 1 },
+    };
+
+    int rows = PARSER_ROWS / logical_files;
+
+    for (int lf = 0; lf < logical_files; lf++)
+    {
+        file->FileHeader(lf + 1);
+        if (lf == 0)
+        {
+            file->Channels(channels, 3);
+            file->Frame("MAIN", channels, 3);
+        }
+
+        for (int row = lf * rows + 1; row <= (lf + 1) * rows; row++)
+        {
+            std::vector<char> name(row + 2, 'x');
+            TestBytes         values;
+
+            name[0]   = 'N';
+            name[row] = 0;
+
+            TestPutFloat(&values, row / 2.0f);
+            TestPutIdent(&values, &name[0]);
+            TestPutIbm(&values, row);
+            file->Row("MAIN", row, values);
+        }
+    }
+
+    file->Flush();
+}
+
+
+/*
+*  фрейм MAIN постоянной длины (16 байт): TIME (FSINGL), DEPT (FDOUBL), VAL (ISINGL),
+*  в строке i: TIME = i / 2, DEPT = 1000 + i, VAL = i. Каждый кадр в своей IFLR
+*/
+static void BuildFixedFile(CTestFile *file)
+{
+    static const TestChannel channels[] =
+    {
+        { "TIME", RC_FSINGL, 1 }, { "DEPT", RC_FDOUBL, 1 }, { "VAL", RC_ISINGL, 1 },
+    };
+
+    file->FileHeader(1);
+    file->Channels(channels, 3);
+    file->Frame("MAIN", channels, 3);
+
+    for (int row = 1; row <= PARSER_ROWS; row++)
+    {
+        TestBytes values;
+
+        TestPutFloat(&values, row / 2.0f);
+        TestPutDouble(&values, 1000.0 + row);
+        TestPutIbm(&values, row);
+        file->Row("MAIN", row, values);
+    }
+
+    file->Flush();
+}
+
+
+struct ProjectionResult
+{
+    int  rows;
+    int  columns;
+    int  bad;
+};
+
+static void ProjectionNotify(CDLISFrame *frame, void *params)
+{
+    ProjectionResult *result = (ProjectionResult *)params;
+    int               dimension;
+
+    result->columns = frame->CountColumns();
+    for (int row = 0; row < frame->CountRows(); row++, result->rows++)
+    {
+        int    number = result->rows + 1;
+        float *time   = frame->GetValueFloat(0, row, &dimension);
+        float *val    = frame->GetValueFloat(1, row, &dimension);
+
+        if (!time || *time != number / 2.0f || !val || *val != (float)number)
+            result->bad++;
+    }
+}
+
+/*
+*  проекция кадра переменной длины только на каналы постоянной длины:
+*  строки хранилища все равно переменной длины, значения берутся по смещениям строки
+*/
+static void CheckVariableProjection()
+{
+    static const char *columns[] = { "TIME", "VAL" };
+
+    CTestFile         file;
+    CDLISParser       parser;
+    ProjectionResult  result = { 0, 0, 0 };
+
+    BuildVariableFile(&file, 1);
+
+    DLIS_CHECK(parser.Initialize());
+    parser.SetChannels(columns, 2);
+    parser.CallbackNotifyFrame(ProjectionNotify, &result);
+    DLIS_CHECK(parser.Parse(&file.data[0], file.data.size()));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.columns == 2);
+    DLIS_CHECK(result.rows == PARSER_ROWS);
+    DLIS_CHECK(result.bad == 0);
+}
+
+
+/*
+*  проекция кадра постоянной длины: остаются только выбранные каналы в порядке кадра,
+*  порядок имен в SetChannels не важен
+*/
+static void CheckProjection()
+{
+    static const char *columns[] = { "VAL", "TIME" };
+
+    CTestFile         file;
+    CDLISParser       parser;
+    ProjectionResult  result = { 0, 0, 0 };
+
+    BuildFixedFile(&file);
+
+    DLIS_CHECK(parser.Initialize());
+    parser.SetChannels(columns, 2);
+    parser.CallbackNotifyFrame(ProjectionNotify, &result);
+    DLIS_CHECK(parser.Parse(&file.data[0], file.data.size()));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.columns == 2);
+    DLIS_CHECK(result.rows == PARSER_ROWS);
+    DLIS_CHECK(result.bad == 0);
+}
+
+
+struct BatchResult
+{
+    int  calls;
+    int  rows;
+    int  max_rows;
+};
+
+static void BatchNotify(CDLISFrame *frame, void *params)
+{
+    BatchResult *result = (BatchResult *)params;
+
+    result->calls++;
+    result->rows += frame->CountRows();
+    if (frame->CountRows() > result->max_rows)
+        result->max_rows = frame->CountRows();
+}
+
+static bool BatchParse(CTestFile *file, int frames, size_t bytes, const char **columns, int count, BatchResult *result)
+{
+    CDLISParser parser;
+    bool        r;
+
+    if (!parser.Initialize())
+        return false;
+
+    parser.SetBatch(frames, bytes);
+    parser.SetChannels(columns, count);
+    parser.CallbackNotifyFrame(BatchNotify, result);
+    r = parser.Parse(&file->data[0], file->data.size());
+    parser.Shutdown();
+
+    return r;
+}
+
+/*
+*  пакет закрывается по числу кадров или по байтам строк хранилища, что наступит раньше;
+*  предел проверяется после IFLR, поэтому по байтам пакет может быть больше предела на один кадр
+*/
+static void CheckBatchLimits()
+{
+    static const char *val[] = { "VAL" };
+
+    // frames, bytes, проекция на VAL (строка 4 байта вместо 16), ожидаемый размер пакета
+    static const struct { int frames; size_t bytes; bool project; int expected; } cases[] =
+    {
+        { 10, 0,          false, 10 },
+        { 0,  6 * 16,     false, 6  },
+        { 0,  6 * 16 - 1, false, 6  },
+        { 10, 6 * 16,     false, 6  },
+        { 4,  6 * 16,     false, 4  },
+        { 0,  8 * 4,      true,  8  },
+    };
+
+    CTestFile file;
+
+    BuildFixedFile(&file);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        BatchResult result = { 0, 0, 0 };
+
+        DLIS_CHECK(BatchParse(&file, cases[i].frames, cases[i].bytes, val, cases[i].project ? 1 : 0, &result));
+
+        DLIS_CHECK(result.rows == PARSER_ROWS);
+        DLIS_CHECK(result.max_rows == cases[i].expected);
+        DLIS_CHECK(result.calls == (PARSER_ROWS + cases[i].expected - 1) / cases[i].expected);
+    }
+}
+
+/*
+*  размер пакета курсора не затирает SetBatch: после прохода ParseNext
+*  Parse отдает кадры пакетами, заданными SetBatch
+*/
+static void CheckCursorKeepsBatch()
+{
+    CTestFile          file;
+    CDLISParser        parser;
+    CDLISMemorySource  source;
+    CDLISFrame        *frame;
+    BatchResult        result = { 0, 0, 0 };
+    bool               error;
+    int                rows = 0;
+
+    BuildVariableFile(&file, 1);
+    source.Attach(&file.data[0], file.data.size());
+
+    DLIS_CHECK(parser.Initialize());
+    parser.SetBatch(7, 0);
+    parser.CallbackNotifyFrame(BatchNotify, &result);
+
+    DLIS_CHECK(parser.ParseBegin(&source));
+    while ((frame = parser.ParseNext(3, &error)) != NULL)
+    {
+        DLIS_CHECK(frame->CountRows() <= 3);
+        rows += frame->CountRows();
+    }
+    DLIS_CHECK(!error);
+    DLIS_CHECK(rows == PARSER_ROWS);
+    DLIS_CHECK(result.calls == 0);
+
+    DLIS_CHECK(parser.Parse(&file.data[0], file.data.size()));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.rows == PARSER_ROWS);
+    DLIS_CHECK(result.max_rows == 7);
+    DLIS_CHECK(result.calls == (PARSER_ROWS + 6) / 7);
+}
+
+/*
+*  курсор закрыт до конца файла: следующий Parse отдает все кадры в callback
+*/
+static void CheckCursorCloseThenParse()
+{
+    CTestFile          file;
+    CDLISParser        parser;
+    CDLISMemorySource  source;
+    CDLISFrameCursor   cursor(&parser);
+    BatchResult        result = { 0, 0, 0 };
+
+    BuildVariableFile(&file, 1);
+    source.Attach(&file.data[0], file.data.size());
+
+    DLIS_CHECK(parser.Initialize());
+    parser.CallbackNotifyFrame(BatchNotify, &result);
+
+    DLIS_CHECK(cursor.Open(&source));
+    DLIS_CHECK(cursor.Next(5) != NULL);
+    cursor.Close();
+
+    DLIS_CHECK(parser.Parse(&file.data[0], file.data.size()));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.rows == PARSER_ROWS);
+    DLIS_CHECK(result.calls == PARSER_ROWS);
+}
+
+
+struct FilesResult
+{
+    int  rows;
+    int  numbers;
+    int  bad;
+};
+
+static void FilesNotify(CDLISFrame *frame, void *params)
+{
+    FilesResult *result = (FilesResult *)params;
+    int          dimension;
+
+    for (int row = 0; row < frame->CountRows(); row++, result->rows++)
+    {
+        int    number = frame->GetNumber(row);
+        float *val    = frame->GetValueFloat(2, row, &dimension);
+
+        result->numbers += number;
+        if (!val || *val != (float)number)
+            result->bad++;
+    }
+}
+
+/*
+*  IFLR логического файла ссылаются на фрейм из предыдущего: при разборе по потокам
+*  кадры не теряются (порядок между логическими файлами не сохраняется, поэтому сверяем сумму номеров)
+*/
+static void CheckFramesFromPreviousFile()
+{
+    CTestFile file;
+
+    BuildVariableFile(&file, 4);
+    DLIS_CHECK(file.Write("TestParser.dlis"));
+
+    for (int threads = 1; threads <= 4; threads *= 2)
+    {
+        CDLISParser  parser;
+        FilesResult  result = { 0, 0, 0 };
+
+        DLIS_CHECK(parser.Initialize());
+        parser.SetFileThreads(threads);
+        parser.CallbackNotifyFrame(FilesNotify, &result);
+        DLIS_CHECK(parser.Parse(L"TestParser.dlis"));
+        parser.Shutdown();
+
+        DLIS_CHECK(result.rows == PARSER_ROWS);
+        DLIS_CHECK(result.numbers == PARSER_ROWS * (PARSER_ROWS + 1) / 2);
+        DLIS_CHECK(result.bad == 0);
+    }
+
+    remove("TestParser.dlis");
+}
+
+struct SettingsResult
+{
+    FilesResult  files;
+    BatchResult  batch;
+};
+
+static void SettingsNotify(CDLISFrame *frame, void *params)
+{
+    SettingsResult *result = (SettingsResult *)params;
+
+    FilesNotify(frame, &result->files);
+    BatchNotify(frame, &result->batch);
+}
+
+/*
+*  участки логических файлов разбираются с настройками владельца: прямое чтение (переход
+*  к началу участка внутри выровненного блока), упреждающее чтение, конвейер и пакеты
+*/
+static void CheckFileThreadSettings()
+{
+    CTestFile       file;
+    CDLISParser     parser;
+    SettingsResult  result = { { 0, 0, 0 }, { 0, 0, 0 } };
+
+    BuildVariableFile(&file, 4);
+    DLIS_CHECK(file.Write("TestParser.dlis"));
+
+    DLIS_CHECK(parser.Initialize());
+    parser.SetFileThreads(2);
+    parser.SetCacheMode(CDLISFileSource::CACHE_DIRECT);
+    parser.SetReadAhead(2, 4096);
+    parser.SetPipeline(2, 2);
+    parser.SetBatch(3, 0);
+    parser.CallbackNotifyFrame(SettingsNotify, &result);
+    DLIS_CHECK(parser.Parse(L"TestParser.dlis"));
+    parser.Shutdown();
+
+    DLIS_CHECK(result.files.rows == PARSER_ROWS);
+    DLIS_CHECK(result.files.numbers == PARSER_ROWS * (PARSER_ROWS + 1) / 2);
+    DLIS_CHECK(result.files.bad == 0);
+    DLIS_CHECK(result.batch.max_rows == 3);
+
+    remove("TestParser.dlis");
+}
+
+
+void TestParser()
+{
+    CheckVariableProjection();
+    CheckProjection();
+    CheckBatchLimits();
+    CheckCursorKeepsBatch();
+    CheckCursorCloseThenParse();
+    CheckFramesFromPreviousFile();
+    CheckFileThreadSettings();
+}
@@ -0,0 +1,84 @@
+#include "StdAfx.h"
+#include "DlisTest.h"
+#include "DLISParser.h"
+
+#include <string.h>
+#include <vector>
+
+typedef std::vector<unsigned char> Bytes;
+
+static const wchar_t *s_sample = L"../../Dlis_examples/Sample2.dlis";
+
+static void PutBytes(Bytes *dst, const void *data, size_t len)
+{
+    dst->insert(dst->end(), (const unsigned char *)data, (const unsigned char *)data + len);
+}
+
+/*
+*  все, что отдано в callback, подряд: имя фрейма, номера кадров и байты значений
+*  (FSHORT - уже преобразованные во float)
+*/
+static void DumpNotify(CDLISFrame *frame, void *params)
+{
+    Bytes *dump = (Bytes *)params;
+    int    dimension, number;
+
+    PutBytes(dump, frame->GetObject()->identifier, strlen(frame->GetObject()->identifier) + 1);
+    for (int row = 0; row < frame->CountRows(); row++)
+    {
+        number = frame->GetNumber(row);
+        PutBytes(dump, &number, sizeof(number));
+
+        for (int column = 0; column < frame->CountColumns(); column++)
+        {
+            const DlisChannelInfo *channel = frame->GetChannel(column);
+            float                 *value   = frame->GetValueFloat(column, row, &dimension);
+            int                    size    = channel->code == RC_FSHORT ? (int)sizeof(float) : channel->element_size;
+
+            if (value && size > 0)
+                PutBytes(dump, value, (size_t)dimension * size);
+        }
+    }
+}
+
+static bool DumpParse(int depth, int threads, Bytes *dump)
+{
+    CDLISParser parser;
+    bool        r;
+
+    if (!parser.Initialize())
+        return false;
+
+    parser.SetPipeline(depth, threads);
+    parser.CallbackNotifyFrame(DumpNotify, dump);
+    r = parser.Parse(s_sample);
+    parser.Shutdown();
+
+    return r;
+}
+
+/*
+*  конвейер с несколькими потоками преобразования отдает те же значения
+*  в том же порядке, что и последовательный разбор
+*/
+static void CheckDeterministic()
+{
+    Bytes sequential;
+
+    DLIS_CHECK(DumpParse(0, 1, &sequential));
+    DLIS_CHECK(!sequential.empty());
+
+    for (int threads = 1; threads <= 4; threads++)
+    {
+        Bytes piped;
+
+        DLIS_CHECK(DumpParse(4, threads, &piped));
+        DLIS_CHECK(piped == sequential);
+    }
+}
+
+
+void TestPipeline()
+{
+    CheckDeterministic();
+}